@@ -3,12 +3,14 @@
 #include "storage.h"
 #include "sugarcane.h"
 
+constexpr size_t g_MapStoreBudget = 512 * 1024 * 1024; // bytes of maps and artifacts kept in tws-maps
+
 int main(int argc, const char **argv)
 {
     IStorage *pStorage = CreateStorage();
     ISugarcane *pSugarcane = CreateSugarcane();
 
-    pStorage->Init();
+    pStorage->Init(g_MapStoreBudget);
     pSugarcane->Init(pStorage, argc, argv);
 
     log_msg("main", "start running...");
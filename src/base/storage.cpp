@@ -1,72 +1,348 @@
 #include <include/base.h>
+#include <teeworlds/map/mappedfile.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "storage.h"
 
-class CFileReader : public IFileReader
+class CFileView : public IFileView
 {
-    std::fstream m_File;
+    CMappedFile m_Mapped;
+    std::vector<char> m_vData; // files that can't be mapped, empty ones for one
+
 public:
-    CFileReader() = default;
+    bool Open(const std::filesystem::path& Path)
+    {
+        std::error_code Error;
+        if(!std::filesystem::is_regular_file(Path, Error))
+            return false;
+        if(m_Mapped.Open(Path))
+            return true;
 
-    bool Open(std::filesystem::path Path)
+        std::ifstream File(Path, std::ios::binary);
+        if(!File)
+            return false;
+        m_vData.assign(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+        return !File.bad();
+    }
+
+    std::span<const char> Data() const override
     {
-        m_File.open(Path, std::ios::in);
-        m_File.seekg(0UL);
+        if(m_Mapped.IsOpen())
+            return std::span<const char>(reinterpret_cast<const char *>(m_Mapped.Data()), m_Mapped.Size());
+        return m_vData;
+    }
 
-        return m_File.is_open();
+    void Close() override
+    {
+        // auto destroy
+        delete this;
     }
+};
+
+class CStorage : public IStorage
+{
+    std::filesystem::path m_CurrentPath;
+
+    // Index of tws-maps/, a map version and the files derived from it are
+    // one entry. It is read from disk once in Init and kept up to date by
+    // every write through the storage, so looking a map up touches no files.
+    // The order of use is saved in tws-maps/store.idx for the next run, and
+    // the last maps loaded per server in tws-maps/usage.log. Saving and
+    // evicting happen on the flush thread a while after the index changed,
+    // never on the caller that loads a map.
+    struct SStoredMap
+    {
+        std::map<std::string, uintmax_t> m_Files; // size by extension
+        uint64_t m_LastUse = 0;
+
+        uintmax_t Bytes() const
+        {
+            uintmax_t Bytes = 0;
+            for(const auto& File : m_Files)
+                Bytes += File.second;
+            return Bytes;
+        }
+    };
+    typedef std::pair<std::string, std::string> CMapKey; // name, crc
+
+    struct SMapUse
+    {
+        std::string m_Server;
+        CMapKey m_Map;
+    };
+    static constexpr size_t MAX_MAP_USES = 64;
 
-    bool ReadLine(string& Line) override
+    std::mutex m_StoreMutex;
+    std::map<CMapKey, SStoredMap> m_Store;
+    std::vector<SMapUse> m_vMapUses; // oldest first
+    uint64_t m_UseClock;
+    size_t m_MapBudget;
+
+    static constexpr std::chrono::seconds FLUSH_DELAY{2}; // changes saved together
+    std::thread m_FlushThread;
+    std::condition_variable m_FlushCond;
+    bool m_StoreDirty;
+    bool m_Shutdown;
+    CMapKey m_ActiveMap; // the map last loaded, never evicted
+
+    // temporary files are named <file>.<token>.<n>.tmp, unique to the process
+    // and the write, so bots sharing tws-maps never touch each other's
+    static constexpr std::chrono::hours STALE_TEMP_AGE{1}; // older ones are reaped
+    std::string m_TempToken;
+    std::atomic<uint64_t> m_TempCounter;
+
+    std::filesystem::path MapsPath() const { return m_CurrentPath / "tws-maps"; }
+
+    // <crc>.<extension> with the first dot, crcs have none
+    static bool SplitMapFile(const std::string& File, std::string& Crc, std::string& Extension)
     {
-        char aBuf[128];
-        if(!m_File.getline(aBuf, sizeof(aBuf)))
+        size_t Dot = File.find('.');
+        if(Dot == std::string::npos || Dot == 0)
             return false;
+        Crc = File.substr(0, Dot);
+        Extension = File.substr(Dot + 1);
+        return true;
+    }
 
-        Line.clear();
-        Line.copy(aBuf);
+    // the next field of a line taken off its front, fields are separated by
+    // spaces and the last one runs to the end of the line
+    static std::string_view NextField(std::string_view& Line, bool Last = false)
+    {
+        size_t Start = std::min(Line.find_first_not_of(' '), Line.size());
+        Line.remove_prefix(Start);
+        size_t End = Last ? Line.size() : std::min(Line.find(' '), Line.size());
+        std::string_view Field = Line.substr(0, End);
+        Line.remove_prefix(End);
+        return Field;
+    }
+
+    std::filesystem::path TempPathFor(const std::filesystem::path& Path)
+    {
+        std::filesystem::path TempPath = Path;
+        TempPath.concat("." + m_TempToken + "." + std::to_string(m_TempCounter++) + ".tmp");
+        return TempPath;
+    }
+
+    // left behind by a write that never finished, one still going on in
+    // another process is younger
+    static bool ReapStaleTemp(const std::filesystem::directory_entry& File)
+    {
+        std::error_code Error;
+        if(File.path().extension() != ".tmp")
+            return false;
+        auto WriteTime = File.last_write_time(Error);
+        if(!Error && std::filesystem::file_time_type::clock::now() - WriteTime > STALE_TEMP_AGE)
+            std::filesystem::remove(File.path(), Error);
         return true;
     }
 
-    bool ReadFile(string& Buffer, size_t Size) override
+    void ScanStore()
     {
-        char *pBuf = new char[Size + 1];
-        if(!m_File.get(pBuf, Size * sizeof(char)))
+        std::error_code Error;
+        for(const auto& MapDir : std::filesystem::directory_iterator(MapsPath(), Error))
         {
-            delete[] pBuf;
-            return false;
+            if(!MapDir.is_directory(Error))
+            {
+                ReapStaleTemp(MapDir);
+                continue;
+            }
+            std::string Map = MapDir.path().filename().string();
+            for(const auto& MapFile : std::filesystem::directory_iterator(MapDir.path(), Error))
+            {
+                std::string Crc, Extension;
+                if(!MapFile.is_regular_file(Error) || !SplitMapFile(MapFile.path().filename().string(), Crc, Extension))
+                    continue;
+                if(ReapStaleTemp(MapFile))
+                    continue;
+                m_Store[CMapKey(Map, Crc)].m_Files[Extension] = MapFile.file_size(Error);
+            }
         }
-        pBuf[Size] = 0;
 
-        Buffer.append(pBuf);
-        delete[] pBuf;
-        return true;
+        // artifacts without their map are of no use
+        for(auto It = m_Store.begin(); It != m_Store.end();)
+        {
+            if(!It->second.m_Files.count("map"))
+            {
+                RemoveStoredFiles(It->first, It->second);
+                It = m_Store.erase(It);
+            }
+            else
+                ++It;
+        }
+
+        CFileView IndexFile;
+        if(IndexFile.Open(MapsPath() / "store.idx"))
+        {
+            CLineIterator Lines(IndexFile.Data());
+            std::string_view Line;
+            while(Lines.Next(Line))
+            {
+                std::string_view Crc = NextField(Line);
+                std::string_view UseField = NextField(Line);
+                std::string_view Map = NextField(Line, true);
+                uint64_t LastUse;
+                if(Map.empty() || std::from_chars(UseField.data(), UseField.data() + UseField.size(), LastUse).ec != std::errc())
+                    continue;
+                auto It = m_Store.find(CMapKey(Map, Crc));
+                if(It != m_Store.end())
+                    It->second.m_LastUse = LastUse;
+                m_UseClock = std::max(m_UseClock, LastUse);
+            }
+        }
+
+        CFileView UsageFile;
+        if(UsageFile.Open(MapsPath() / "usage.log"))
+        {
+            CLineIterator Lines(UsageFile.Data());
+            std::string_view Line;
+            while(Lines.Next(Line))
+            {
+                std::string_view Server = NextField(Line);
+                std::string_view Crc = NextField(Line);
+                std::string_view Map = NextField(Line, true);
+                if(!Map.empty())
+                    m_vMapUses.push_back({std::string(Server), CMapKey(Map, Crc)});
+            }
+        }
     }
 
-    void SetPos(size_t Pos) override
+    void WriteAside(const std::filesystem::path& Path, const std::string& Data)
     {
-        m_File.seekg(Pos);
+        std::filesystem::path TempPath = TempPathFor(Path);
+        std::error_code Error;
+        {
+            std::ofstream File(TempPath, std::ios::trunc);
+            if(!File.write(Data.data(), Data.size()))
+            {
+                File.close();
+                std::filesystem::remove(TempPath, Error);
+                return;
+            }
+        }
+        std::filesystem::rename(TempPath, Path, Error);
+        if(Error)
+            std::filesystem::remove(TempPath, Error);
     }
 
-    void Close() override
+    // the contents of store.idx and usage.log, taken under the store mutex
+    void FormatStoreIndex(std::string& Index, std::string& Usage) const
     {
-        m_File.close();
-        // auto destroy
-        delete this;
+        std::ostringstream IndexStream, UsageStream;
+        for(const auto& Entry : m_Store)
+            IndexStream << Entry.first.second << ' ' << Entry.second.m_LastUse << ' ' << Entry.first.first << '\n';
+        for(const SMapUse& Use : m_vMapUses)
+            UsageStream << Use.m_Server << ' ' << Use.m_Map.second << ' ' << Use.m_Map.first << '\n';
+        Index = IndexStream.str();
+        Usage = UsageStream.str();
+    }
+
+    void MarkStoreDirty()
+    {
+        m_StoreDirty = true;
+        m_FlushCond.notify_one();
+    }
+
+    // evicts and saves the index once it changed, waiting FLUSH_DELAY for
+    // more changes so a burst of writes is saved once
+    void FlushThread()
+    {
+        std::unique_lock<std::mutex> Lock(m_StoreMutex);
+        while(true)
+        {
+            m_FlushCond.wait(Lock, [this]() { return m_StoreDirty || m_Shutdown; });
+            m_FlushCond.wait_for(Lock, FLUSH_DELAY, [this]() { return m_Shutdown; });
+            if(!m_StoreDirty)
+                break;
+            m_StoreDirty = false;
+            EvictMaps(m_ActiveMap);
+            std::string Index, Usage;
+            FormatStoreIndex(Index, Usage);
+
+            // the files are only written from here, the index may move on
+            // meanwhile and is saved again on the next round
+            Lock.unlock();
+            WriteAside(MapsPath() / "store.idx", Index);
+            WriteAside(MapsPath() / "usage.log", Usage);
+            Lock.lock();
+            if(m_Shutdown && !m_StoreDirty)
+                break;
+        }
+    }
+
+    void RemoveStoredFiles(const CMapKey& Key, const SStoredMap& Entry)
+    {
+        std::error_code Error;
+        std::filesystem::path DirPath = MapsPath() / Key.first;
+        for(const auto& File : Entry.m_Files)
+            std::filesystem::remove(DirPath / (Key.second + "." + File.first), Error);
+        if(std::filesystem::is_empty(DirPath, Error))
+            std::filesystem::remove(DirPath, Error);
+    }
+
+    // drops the least recently used maps until the store fits the budget,
+    // never the one in Keep
+    void EvictMaps(const CMapKey& Keep)
+    {
+        if(!m_MapBudget)
+            return;
+        uintmax_t Bytes = 0;
+        for(const auto& Entry : m_Store)
+            Bytes += Entry.second.Bytes();
+        while(Bytes > m_MapBudget)
+        {
+            auto Oldest = m_Store.end();
+            for(auto It = m_Store.begin(); It != m_Store.end(); ++It)
+                if(It->first != Keep && (Oldest == m_Store.end() || It->second.m_LastUse < Oldest->second.m_LastUse))
+                    Oldest = It;
+            if(Oldest == m_Store.end())
+                break;
+            log_msgf("storage", "evict teeworlds map {}/{}, {} KiB", Oldest->first.first, Oldest->first.second, Oldest->second.Bytes() / 1024);
+            Bytes -= Oldest->second.Bytes();
+            RemoveStoredFiles(Oldest->first, Oldest->second);
+            m_Store.erase(Oldest);
+        }
     }
-};
 
-class CStorage : public IStorage
-{
-    std::filesystem::path m_CurrentPath;
 public:
     CStorage() 
     {
         m_CurrentPath.clear();
+        m_UseClock = 0;
+        m_MapBudget = 0;
+        m_StoreDirty = false;
+        m_Shutdown = false;
+        m_TempCounter = 0;
+        std::random_device Random;
+        m_TempToken = std::format("{:08x}", Random());
+    }
+
+    ~CStorage() override
+    {
+        {
+            std::lock_guard<std::mutex> Lock(m_StoreMutex);
+            m_Shutdown = true;
+        }
+        m_FlushCond.notify_one();
+        if(m_FlushThread.joinable())
+            m_FlushThread.join();
     }
 
-    void Init() override
+    void Init(size_t MapBudget) override
     {
         m_CurrentPath = std::filesystem::current_path();
         log_msgf("storage", "init current path: {}", m_CurrentPath.c_str());
@@ -75,6 +351,16 @@ public:
         Path.append("tws-maps");
         if(!std::filesystem::exists(Path))
             std::filesystem::create_directory(Path);
+
+        std::lock_guard<std::mutex> Lock(m_StoreMutex);
+        m_MapBudget = MapBudget;
+        ScanStore();
+        uintmax_t Bytes = 0;
+        for(const auto& Entry : m_Store)
+            Bytes += Entry.second.Bytes();
+        log_msgf("storage", "map store: {} maps, {} KiB, budget {}", m_Store.size(), Bytes / 1024, MapBudget ? std::to_string(MapBudget / 1024) + " KiB" : std::string("unlimited"));
+        if(!m_FlushThread.joinable())
+            m_FlushThread = std::thread(&CStorage::FlushThread, this);
     }
 
     void WriteFile(string Dir, string File, string Extension, void *pData, bool Rewrite) override
@@ -110,7 +396,7 @@ public:
         return std::filesystem::exists(Path);
     }
 
-    IFileReader *ReadFile(string Dir, string File, string Extension) override
+    IFileView *ViewFile(string Dir, string File, string Extension) override
     {
         std::filesystem::path Path = m_CurrentPath;
         Path.append(Dir.c_str());
@@ -118,70 +404,157 @@ public:
         Path.concat(".");
         Path.concat(Extension.c_str());
 
-        return ReadFile(Path.c_str());
+        return ViewFile(Path.c_str());
     }
 
-    IFileReader *ReadFile(string Path) override
+    IFileView *ViewFile(string Path) override
     {
-        CFileReader *pFileReader = new CFileReader();
-        if(!pFileReader->Open(Path.c_str()))
+        CFileView *pFileView = new CFileView();
+        if(!pFileView->Open(Path.c_str()))
         {
             log_msgf("storage", "failed open file '{}'", Path.c_str());
 
-            delete pFileReader;
+            delete pFileView;
             return nullptr;
         }
-        return pFileReader;
+        return pFileView;
     }
 
     /* teeworlds */
-    IFileReader *ReadMap(string Map, string MapCrc) override
+    IFileView *ReadMap(string Map, string MapCrc) override
     {
-        std::filesystem::path Path = m_CurrentPath;
-        Path.append("tws-maps");
-        Path.append(Map.c_str());
-        Path.append(MapCrc.c_str());
-        Path.concat(".map");
-
-        return ReadFile(Path.c_str());
+        return ViewFile(TwsMapDataPath(Map, MapCrc, "map").c_str());
     }
 
     bool TwsMapExists(string Map, string MapCrc) override
     {
-        std::filesystem::path Path = m_CurrentPath;
-        Path.append("tws-maps");
-        Path.append(Map.c_str());
-        Path.append(MapCrc.c_str());
-        Path.concat(".map");
+        std::lock_guard<std::mutex> Lock(m_StoreMutex);
+        auto It = m_Store.find(CMapKey(Map.c_str(), MapCrc.c_str()));
+        if(It == m_Store.end())
+            return false;
+        It->second.m_LastUse = ++m_UseClock;
+        return true;
+    }
 
-        std::filesystem::path DirPath = m_CurrentPath;
-        DirPath.append("tws-maps");
-        DirPath.append(Map.c_str());
-        if(!std::filesystem::exists((DirPath)))
-            std::filesystem::create_directory(DirPath);
+    bool TwsDownloadMap(string Map, string MapCrc, const void *pData, int Size) override
+    {
+        // a download that breaks off never shows up as a map
+        return TwsWriteMapData(Map, MapCrc, "map", pData, Size);
+    }
 
-        return std::filesystem::exists(Path);
+    void TwsDropMap(string Map, string MapCrc) override
+    {
+        CMapKey Key(Map.c_str(), MapCrc.c_str());
+        std::lock_guard<std::mutex> Lock(m_StoreMutex);
+        auto It = m_Store.find(Key);
+        if(It == m_Store.end())
+            return;
+        log_msgf("storage", "drop teeworlds map {}/{}", Key.first, Key.second);
+        RemoveStoredFiles(Key, It->second);
+        m_Store.erase(It);
+        std::erase_if(m_vMapUses, [&](const SMapUse& Use) { return Use.m_Map == Key; });
+        MarkStoreDirty();
+    }
+
+    void TwsUseMap(string Map, string MapCrc, string Server) override
+    {
+        CMapKey Key(Map.c_str(), MapCrc.c_str());
+        std::lock_guard<std::mutex> Lock(m_StoreMutex);
+        auto It = m_Store.find(Key);
+        if(It == m_Store.end())
+            return;
+        It->second.m_LastUse = ++m_UseClock;
+
+        std::erase_if(m_vMapUses, [&](const SMapUse& Use) { return Use.m_Server == Server.c_str() && Use.m_Map == Key; });
+        m_vMapUses.push_back({Server.c_str(), Key});
+        if(m_vMapUses.size() > MAX_MAP_USES)
+            m_vMapUses.erase(m_vMapUses.begin());
+
+        m_ActiveMap = Key;
+        MarkStoreDirty();
+    }
+
+    void TwsRecentMaps(string Server, int Max, std::vector<std::pair<std::string, std::string>>& vMaps) override
+    {
+        vMaps.clear();
+        std::lock_guard<std::mutex> Lock(m_StoreMutex);
+        for(auto It = m_vMapUses.rbegin(); It != m_vMapUses.rend() && (int) vMaps.size() < Max; ++It)
+            if(It->m_Server == Server.c_str() && m_Store.count(It->m_Map))
+                vMaps.push_back(It->m_Map);
     }
 
-    bool TwsDownloadMap(string Map, string MapCrc, void* pData, int Size) override
+    std::filesystem::path TwsMapDataPath(string Map, string MapCrc, string Extension)
     {
         std::filesystem::path Path = m_CurrentPath;
         Path.append("tws-maps");
         Path.append(Map.c_str());
         Path.append(MapCrc.c_str());
-        Path.concat(".map");
+        Path.concat(".");
+        Path.concat(Extension.c_str());
+        return Path;
+    }
 
-        std::ofstream MapFile;
-        MapFile.open(Path, std::ios::app);
+    IFileView *TwsViewMapData(string Map, string MapCrc, string Extension) override
+    {
+        // missing artifacts are expected, they are built on first use
+        CFileView *pFileView = new CFileView();
+        if(!pFileView->Open(TwsMapDataPath(Map, MapCrc, Extension)))
+        {
+            delete pFileView;
+            return nullptr;
+        }
+        return pFileView;
+    }
+
+    bool TwsWriteMapData(string Map, string MapCrc, string Extension, const void *pData, size_t Size) override
+    {
+        std::filesystem::path Path = TwsMapDataPath(Map, MapCrc, Extension);
+        std::filesystem::create_directories(Path.parent_path());
 
-        if(!MapFile)
+        // write aside and rename, a reader never sees half a file
+        std::filesystem::path TempPath = TempPathFor(Path);
         {
-            log_msgf("storage", "download part of teeworlds map to {} failed", Path.c_str());
+            std::ofstream DataFile(TempPath, std::ios::binary | std::ios::trunc);
+            if(!DataFile || !DataFile.write((const char *) pData, Size))
+            {
+                log_msgf("storage", "write teeworlds map data to {} failed", TempPath.c_str());
+                DataFile.close();
+                std::error_code Error;
+                std::filesystem::remove(TempPath, Error);
+                return false;
+            }
+        }
+
+        std::error_code Error;
+        std::filesystem::rename(TempPath, Path, Error);
+        if(Error)
+        {
+            log_msgf("storage", "write teeworlds map data to {} failed", Path.c_str());
+            std::filesystem::remove(TempPath, Error);
             return false;
         }
-        MapFile.write((const char *) pData, Size);
-        MapFile.close();
 
+        CMapKey Key(Map.c_str(), MapCrc.c_str());
+        std::lock_guard<std::mutex> Lock(m_StoreMutex);
+        bool IsMap = !strcmp(Extension.c_str(), "map");
+        auto It = m_Store.find(Key);
+        if(!IsMap && (It == m_Store.end() || !It->second.m_Files.count("map")))
+        {
+            // the map was evicted or dropped meanwhile, artifacts without
+            // their map are of no use
+            log_msgf("storage", "teeworlds map {}/{} is not stored, drop its {}", Key.first, Key.second, Extension.c_str());
+            std::filesystem::remove(Path, Error);
+            return false;
+        }
+        if(It == m_Store.end())
+            It = m_Store.emplace(Key, SStoredMap()).first;
+        It->second.m_Files[Extension.c_str()] = Size;
+        if(IsMap)
+        {
+            It->second.m_LastUse = ++m_UseClock;
+            m_ActiveMap = Key;
+        }
+        MarkStoreDirty();
         return true;
     }
 };
@@ -3,30 +3,105 @@
 
 #include <include/base.h>
 
-class IFileReader
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A whole file as read-only memory, mapped where the file allows it and read
+// in one go where not. Nothing is copied out of it, lines and records point
+// into the view and stay valid until Close.
+class IFileView
 {
 public:
-    virtual bool ReadLine(string& Line) = 0;
-    virtual bool ReadFile(string& Buffer, size_t Size) = 0;
-    virtual void SetPos(size_t Pos) = 0;
+    virtual ~IFileView() = default;
+    virtual std::span<const char> Data() const = 0;
     virtual void Close() = 0;
 };
 
+// Walks a view line by line. Lines end in '\n' or "\r\n", the end is not
+// part of the line and the last line may go without one.
+class CLineIterator
+{
+    std::span<const char> m_Data;
+    size_t m_Pos;
+
+public:
+    explicit CLineIterator(std::span<const char> Data) :
+        m_Data(Data), m_Pos(0) {}
+
+    bool Next(std::string_view& Line)
+    {
+        if(m_Pos >= m_Data.size())
+            return false;
+        std::string_view Rest(m_Data.data() + m_Pos, m_Data.size() - m_Pos);
+        size_t End = Rest.find('\n');
+        Line = Rest.substr(0, End);
+        m_Pos += End == std::string_view::npos ? Rest.size() : End + 1;
+        if(!Line.empty() && Line.back() == '\r')
+            Line.remove_suffix(1);
+        return true;
+    }
+    // bytes consumed so far
+    size_t Offset() const { return m_Pos; }
+};
+
+// Walks a view in records of a fixed size, a shorter tail is left over.
+class CRecordIterator
+{
+    std::span<const char> m_Data;
+    size_t m_RecordSize;
+    size_t m_Pos;
+
+public:
+    CRecordIterator(std::span<const char> Data, size_t RecordSize) :
+        m_Data(Data), m_RecordSize(RecordSize), m_Pos(0) {}
+
+    bool Next(std::span<const char>& Record)
+    {
+        if(!m_RecordSize || m_Data.size() - m_Pos < m_RecordSize)
+            return false;
+        Record = m_Data.subspan(m_Pos, m_RecordSize);
+        m_Pos += m_RecordSize;
+        return true;
+    }
+    size_t Remaining() const { return m_Data.size() - m_Pos; }
+};
+
 class IStorage
 {
 public:
-    virtual void Init() = 0;
+    virtual ~IStorage() = default;
+    // MapBudget bounds the bytes of maps and their artifacts kept in
+    // tws-maps/, 0 keeps everything
+    virtual void Init(size_t MapBudget = 0) = 0;
     virtual void WriteFile(string Dir, string File, string Extension, void *pData, bool Rewrite = false) = 0;
 
     virtual bool FileExists(string Dir, string File, string Extension) = 0;
 
-    virtual IFileReader *ReadFile(string Dir, string File, string Extension) = 0;
-    virtual IFileReader *ReadFile(string Path) = 0;
+    // nullptr when the file can't be opened
+    virtual IFileView *ViewFile(string Dir, string File, string Extension) = 0;
+    virtual IFileView *ViewFile(string Path) = 0;
     
     /* teeworlds */
-    virtual IFileReader *ReadMap(string Map, string MapCrc) = 0;
+    virtual IFileView *ReadMap(string Map, string MapCrc) = 0;
+    // answered from the map store index, counts as a use of the map
     virtual bool TwsMapExists(string Map, string MapCrc) = 0;
-    virtual bool TwsDownloadMap(string Map, string MapCrc, void* pData, int Size) = 0;
+    // a whole downloaded map, written aside and renamed into place
+    virtual bool TwsDownloadMap(string Map, string MapCrc, const void *pData, int Size) = 0;
+    // a stored map that turned out missing or broken, forgets it and removes
+    // what is left of its files so it is downloaded again
+    virtual void TwsDropMap(string Map, string MapCrc) = 0;
+    // a map was loaded on Server, old maps over the budget are evicted
+    // later on
+    virtual void TwsUseMap(string Map, string MapCrc, string Server) = 0;
+    // up to Max stored maps last used on Server as (name, crc), newest first
+    virtual void TwsRecentMaps(string Server, int Max, std::vector<std::pair<std::string, std::string>>& vMaps) = 0;
+    // binary data derived from a map, stored next to it as <crc>.<extension>,
+    // writing it fails once the map itself is no longer stored
+    virtual IFileView *TwsViewMapData(string Map, string MapCrc, string Extension) = 0;
+    virtual bool TwsWriteMapData(string Map, string MapCrc, string Extension, const void *pData, size_t Size) = 0;
 };
 
 extern IStorage *CreateStorage();
@@ -27,10 +27,16 @@ public:
     virtual void RecvDDNetMsg(int MsgID, void *pData) = 0;
     virtual void DDNetTick(int *pInputData) = 0;
     virtual void StartSnap() = 0; 
+    // after the last item of a snapshot
+    virtual void EndSnap() = 0;
+    // the server sent new tuning, the client holds it already
+    virtual void TuningChanged() = 0;
 
-    virtual bool DownloadMap(const char *pMap, int Crc, void* pData, int Size) = 0;
+    // the whole downloaded map, stored only if it matches Crc
+    virtual bool DownloadMap(const char *pMap, int Crc, const void *pData, int Size) = 0;
     virtual bool CheckMap(const char *pMap, int Crc) = 0;
-    virtual bool LoadMap(const char *pMap, int Crc) = 0;
+    // pData holds the map file when the caller has it in memory already
+    virtual bool LoadMap(const char *pMap, int Crc, const void *pData = nullptr, int Size = 0) = 0;
     virtual bool NeedSendInput() = 0;
 };
 
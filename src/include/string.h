@@ -56,14 +56,15 @@ public:
         if(!pappend)
             return;
 
-        strsize += strlen(pappend);
+        size_t oldlength = length();
+        size_t appendlength = strlen(pappend);
+        strsize = oldlength + appendlength + 1;
         if(str)
             str = (char *) realloc(str, sizeof(char) * strsize);
         else
             str = (char *) malloc(sizeof(char) * strsize);
 
-        memcpy(str + length(), pappend, strlen(pappend) + 1);
-        str[strsize - 1] = '\0';
+        memcpy(str + oldlength, pappend, appendlength + 1);
     }
 
     inline void moveto(void *pDest)
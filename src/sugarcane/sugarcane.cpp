@@ -54,13 +54,16 @@ void CSugarcane::Init(IStorage *pStorage, int argc, const char **argv)
 
 #define BAMCANE_AISERVER "sh.teemidnight.online"
 #define CR_SERVER "81.70.102.43:8303"
+#define MAP_DOWNLOAD_WINDOW 8 // map chunks in flight, the client allows up to 16
 void CSugarcane::Run()
 {
 	signal(SIGINT, HandleSigIntTerm);
 	signal(SIGTERM, HandleSigIntTerm);
 
-    DDNet::ConnectTo(CR_SERVER, this);
+    WarmUpMaps(CR_SERVER);
+    DDNet::ConnectTo(CR_SERVER, this, MAP_DOWNLOAD_WINDOW);
 
+	ShutdownTwsPart();
 	m_Shutdown = true;
 }
 
@@ -20,6 +20,10 @@ private:
 
     /* teeworlds */
     void InitTwsPart();
+    // joins the threads of the teeworlds part
+    void ShutdownTwsPart();
+    // prepares the maps last played on the server while connecting
+    void WarmUpMaps(const char *pServer);
     void InputPrediction();
 
     static void TwsResponseBack(string Response);
@@ -38,10 +42,12 @@ public:
     void RecvDDNetMsg(int MsgID, void *pData) override;
     void DDNetTick(int *pInputData) override;
     void StartSnap() override;
+    void EndSnap() override;
+    void TuningChanged() override;
 
-    bool DownloadMap(const char *pMap, int Crc, void* pData, int Size) override;
+    bool DownloadMap(const char *pMap, int Crc, const void *pData, int Size) override;
     bool CheckMap(const char *pMap, int Crc) override;
-    bool LoadMap(const char *pMap, int Crc) override;
+    bool LoadMap(const char *pMap, int Crc, const void *pData = nullptr, int Size = 0) override;
     bool NeedSendInput() override;
 };
 
@@ -26,96 +26,252 @@ SOFTWARE.
 
 #include <include/base.h>
 #include <algorithm>
-#include <cmath>
-#include <map>
-#include <queue>
-#include <unordered_map>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
+#include "map/tilelayer.h"
+#include "wavefront.h"
+
+// Distance field towards one or more goal tiles. Every move costs one tile,
+// so the field is filled by a plain FIFO breadth-first search into a single
+// row-major buffer. An instance can be rebuilt with build() and keeps its
+// buffers between calls, so the per-tick rebuild does not allocate.
+// With several goals all of them seed the same frontier, and every reached
+// cell remembers the index of the goal it is closest to.
 class AStar
 {
 public:
+	static constexpr uint16_t UNREACHED = std::numeric_limits<uint16_t>::max();
+	static constexpr uint16_t NO_GOAL = std::numeric_limits<uint16_t>::max();
+
+	AStar() :
+		rows(0), cols(0), backend(CBitWavefront::BACKEND_QUEUE) {}
+
 	AStar(const std::vector<std::vector<int>> &grid, std::pair<int, int> goal) :
-		grid(grid), rows(grid.size()), cols(grid[0].size())
+		rows(0), cols(0), backend(CBitWavefront::BACKEND_QUEUE)
 	{
-		distance = std::vector<std::vector<double>>(rows, std::vector<double>(cols, std::numeric_limits<double>::infinity()));
-		dijkstra(goal.first, goal.second);
+		build(grid, goal);
 	}
 
 	AStar(const std::vector<std::vector<int>> &grid, std::vector<std::pair<int, int>> goals) :
-		grid(grid), rows(grid.size()), cols(grid[0].size())
+		rows(0), cols(0), backend(CBitWavefront::BACKEND_QUEUE)
 	{
-		distance = std::vector<std::vector<double>>(rows, std::vector<double>(cols, std::numeric_limits<double>::infinity()));
-		for(size_t i = 0; i < goals.size(); i++)
-		{
-			dijkstra(goals[i].first, goals[i].second);
-		}
+		build(grid, goals);
 	}
 
-	struct Node
+	// Search used by single-goal builds, one of CBitWavefront::BACKEND_*.
+	// Multi-goal fields always use the queue, they track the owner per cell.
+	void setBackend(int Backend)
 	{
-		int y, x;
-		double dist;
+		backend = CBitWavefront::Supported(Backend) ? Backend : CBitWavefront::BACKEND_QUEUE;
+	}
 
-		Node(int y, int x, double dist) :
-			x(x), y(y), dist(dist) {}
+	int getBackend() const
+	{
+		return backend;
+	}
 
-		double f() const { return dist; }
+	void build(const std::vector<std::vector<int>> &grid, std::pair<int, int> goal)
+	{
+		reset(grid);
+		search(goal);
+	}
 
-		bool operator>(const Node &other) const { return f() > other.f(); }
-	};
+	// The same from the tile layer, with the cells in danger (sorted tile
+	// indices) treated as death tiles.
+	void build(const CTileLayer &layer, const std::vector<int> &danger, std::pair<int, int> goal)
+	{
+		reset(layer, danger);
+		search(goal);
+	}
 
-	int distanceToGoal(int Y, int X)
+	void build(const std::vector<std::vector<int>> &grid, const std::vector<std::pair<int, int>> &goals)
 	{
-		return distance[Y][X];
+		reset(grid);
+		search(goals);
 	}
 
-	int distanceToGoal(std::pair<int, int> pos)
+	void build(const CTileLayer &layer, const std::vector<int> &danger, const std::vector<std::pair<int, int>> &goals)
 	{
-		return distance[pos.first][pos.second] == 0;
+		reset(layer, danger);
+		search(goals);
 	}
 
-	bool isGoal(int Y, int X)
+	// Index of the goal the cell is closest to, -1 if no goal reaches it.
+	int goalOf(int Y, int X) const
 	{
-		return distance[Y][X] == 0;
+		if(Y < 0 || Y >= rows || X < 0 || X >= cols || distance[index(Y, X)] == UNREACHED)
+			return -1;
+		if(owner.empty())
+			return 0;
+		return owner[index(Y, X)] == NO_GOAL ? -1 : owner[index(Y, X)];
 	}
 
-	bool isGoal(std::pair<int, int> pos)
+	int goalOf(std::pair<int, int> pos) const
 	{
-		return distance[pos.first][pos.second] == 0;
+		return goalOf(pos.first, pos.second);
+	}
+
+	// Repair the field after the grid changed at the given cell indices
+	// instead of rebuilding it. GetCell(y, x) returns the new grid value.
+	// Distances that depended on a cell which closed are raised first, then
+	// the opened and raised cells are lowered again from their neighbours,
+	// so the work is proportional to the region that actually changed.
+	template<typename FGetCell>
+	void repair(const std::vector<int> &changed, FGetCell &&GetCell)
+	{
+		touched.clear();
+		for(int Cell : changed)
+		{
+			if(Cell < 0 || Cell >= rows * cols)
+				continue;
+			touched.push_back(Cell);
+			if(Cell >= cols)
+				touched.push_back(Cell - cols); // danger also looks one row down
+		}
+		std::sort(touched.begin(), touched.end());
+		touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+		seeds.clear();
+		frontier.clear();
+		for(int Cell : touched)
+		{
+			int y = Cell / cols;
+			int x = Cell % cols;
+			int Value = GetCell(y, x);
+			uint8_t Flags = Value == 0 ? CELL_VALID : 0;
+			if(y < rows - 1 && (Value == -1 || GetCell(y + 1, x) == -1))
+				Flags |= CELL_DANGEROUS;
+
+			bool WasOpen = cells[Cell] == CELL_VALID;
+			cells[Cell] = Flags;
+			if(WasOpen == (Flags == CELL_VALID) || distance[Cell] == 0)
+				continue;
+
+			if(WasOpen)
+			{
+				if(distance[Cell] != UNREACHED)
+					seeds.push_back({distance[Cell], Cell});
+				distance[Cell] = UNREACHED;
+			}
+			else
+				frontier.push_back(Cell);
+		}
+
+		// raise, level by level, so a cell is only dropped once every
+		// possible support one step closer to the goal is known to be gone
+		std::sort(seeds.begin(), seeds.end());
+		for(size_t Seed = 0; Seed < seeds.size();)
+		{
+			uint16_t Level = seeds[Seed].first;
+			current.clear();
+			while(Seed < seeds.size() && seeds[Seed].first == Level)
+				current.push_back(seeds[Seed++].second);
+
+			while(!current.empty() && Level + 1 < UNREACHED)
+			{
+				next.clear();
+				uint16_t Dependent = Level + 1;
+				for(int Cell : current)
+				{
+					forNeighbours(Cell, [&](int Neighbour) {
+						if(distance[Neighbour] != Dependent || isSupported(Neighbour))
+							return;
+						distance[Neighbour] = UNREACHED;
+						next.push_back(Neighbour);
+						frontier.push_back(Neighbour);
+					});
+				}
+				current.swap(next);
+				Level++;
+				while(Seed < seeds.size() && seeds[Seed].first == Level)
+					current.push_back(seeds[Seed++].second);
+			}
+		}
+
+		// lower, a Dijkstra over unit costs seeded with the best neighbour of
+		// every opened or raised cell
+		seeds.clear();
+		for(int Cell : frontier)
+		{
+			if(cells[Cell] != CELL_VALID)
+				continue;
+			uint16_t Best = UNREACHED;
+			forNeighbours(Cell, [&](int Neighbour) {
+				if(distance[Neighbour] != UNREACHED)
+					Best = std::min<uint16_t>(Best, distance[Neighbour] + 1);
+			});
+			if(Best < UNREACHED && Best < distance[Cell])
+				seeds.push_back({Best, Cell});
+		}
+
+		std::sort(seeds.begin(), seeds.end());
+		for(size_t Seed = 0; Seed < seeds.size();)
+		{
+			uint16_t Level = seeds[Seed].first;
+			current.clear();
+			while(!current.empty() || (Seed < seeds.size() && seeds[Seed].first == Level))
+			{
+				while(Seed < seeds.size() && seeds[Seed].first == Level)
+					current.push_back(seeds[Seed++].second);
+
+				next.clear();
+				for(int Cell : current)
+				{
+					if(distance[Cell] <= Level)
+						continue;
+					distance[Cell] = Level;
+					if(!owner.empty())
+						inheritOwner(Cell);
+					if(Level + 1 == UNREACHED)
+						continue;
+					forNeighbours(Cell, [&](int Neighbour) {
+						if(cells[Neighbour] == CELL_VALID && distance[Neighbour] > Level + 1)
+							next.push_back(Neighbour);
+					});
+				}
+				current.swap(next);
+				Level++;
+			}
+		}
+	}
+
+	int distanceToGoal(int Y, int X) const
+	{
+		return distance[index(Y, X)];
+	}
+
+	int distanceToGoal(std::pair<int, int> pos) const
+	{
+		return distance[index(pos.first, pos.second)];
+	}
+
+	bool isGoal(int Y, int X) const
+	{
+		return distance[index(Y, X)] == 0;
+	}
+
+	bool isGoal(std::pair<int, int> pos) const
+	{
+		return distance[index(pos.first, pos.second)] == 0;
 	}
 
 	std::vector<std::pair<int, int>> findPath(std::pair<int, int> start, int max_length = 30)
 	{
 		auto [sy, sx] = start;
 
-		if(!isValid(sy, sx) && !isDangerous(sy, sx))
+		if(!canStart(sy, sx))
 			return {}; // Start is invalid
 		if(isGoal(start))
 			return {};
 
 		std::vector<std::pair<int, int>> ret;
-		std::vector<std::pair<int, int>> directions = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
 		int y = sy;
 		int x = sx;
-		for(size_t i = 0; i < max_length; i++)
+		for(int i = 0; i < max_length; i++)
 		{
-			std::pair<int, int> bestMove = {-1, -1};
-			double minDistance = std::numeric_limits<double>::infinity();
-			for(const auto &[dy, dx] : directions)
-			{
-				int ny = y + dy;
-				int nx = x + dx;
-
-				if(isValid(ny, nx) && !isDangerous(ny, nx) && distance[ny][nx] < minDistance)
-				{
-					minDistance = distance[ny][nx];
-					bestMove = {dy, dx};
-					if(isDangerous(ny + 1, nx))
-						bestMove.first = -1;
-				}
-			}
-
+			std::pair<int, int> bestMove = nextMove(y, x);
 			if(bestMove == std::pair<int, int>{-1, -1})
 			{
 				break; // No valid move found, end the search
@@ -133,58 +289,258 @@ public:
 		return ret;
 	}
 
+	// Whether findPath accepts (Y, X) as a start.
+	bool canStart(int Y, int X) const
+	{
+		return isValid(Y, X) || isDangerous(Y, X);
+	}
+
+	// The move findPath takes from (Y, X), {-1, -1} if there is none. The
+	// move goes up instead when the tile below its target is dangerous.
+	std::pair<int, int> nextMove(int Y, int X) const
+	{
+		static const std::pair<int, int> directions[] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+		std::pair<int, int> bestMove = {-1, -1};
+		uint16_t minDistance = UNREACHED;
+		for(const auto &[dy, dx] : directions)
+		{
+			int ny = Y + dy;
+			int nx = X + dx;
+
+			if(isOpen(ny, nx) && distance[index(ny, nx)] < minDistance)
+			{
+				minDistance = distance[index(ny, nx)];
+				bestMove = {dy, dx};
+				if(isDangerous(ny + 1, nx))
+					bestMove.first = -1;
+			}
+		}
+		return bestMove;
+	}
+
+	int getRows() const
+	{
+		return rows;
+	}
+
+	int getCols() const
+	{
+		return cols;
+	}
+
 private:
-	const std::vector<std::vector<int>> &grid;
+	enum
+	{
+		CELL_VALID = 1 << 0,
+		CELL_DANGEROUS = 1 << 1,
+	};
+
 	int rows, cols;
-	std::vector<std::vector<double>> distance;
+	int backend;
+	std::vector<uint8_t> cells;
+	std::vector<uint16_t> distance;
+	std::vector<uint16_t> owner; // only kept for multi-goal fields
+	std::vector<int> frontier;
+
+	// scratch space of repair()
+	std::vector<int> touched;
+	std::vector<int> current;
+	std::vector<int> next;
+	std::vector<std::pair<uint16_t, int>> seeds;
+
+	int index(int y, int x) const
+	{
+		return y * cols + x;
+	}
+
+	bool inside(int y, int x) const
+	{
+		return y >= 0 && y < rows && x >= 0 && x < cols;
+	}
 
 	bool isValid(int y, int x) const
 	{
-		return y >= 0 && y < rows && x >= 0 && x < cols && grid[y][x] == 0;
+		return inside(y, x) && (cells[index(y, x)] & CELL_VALID);
 	}
 
 	bool isDangerous(int y, int x) const
 	{
-		return y >= 0 && y < rows - 1 && x >= 0 && x < cols && (grid[y][x] == -1 || grid[y + 1][x] == -1);
+		return inside(y, x) && (cells[index(y, x)] & CELL_DANGEROUS);
 	}
 
-	// Run Dijkstra's algorithm from a single source node
-	std::vector<std::vector<double>> dijkstra(int goalY, int goalX)
+	bool isOpen(int y, int x) const
 	{
-		std::priority_queue<Node, std::vector<Node>, std::greater<Node>> pq;
+		return inside(y, x) && cells[index(y, x)] == CELL_VALID;
+	}
 
-		distance[clamp(goalY, 0, rows - 1)][clamp(goalX, 0, cols - 1)] = 0;
-		pq.push(Node(clamp(goalY, 0, rows - 1), clamp(goalX, 0, cols - 1), 0));
+	template<typename F>
+	void forNeighbours(int Cell, F &&Func) const
+	{
+		int x = Cell % cols;
+		if(x + 1 < cols)
+			Func(Cell + 1);
+		if(Cell + cols < rows * cols)
+			Func(Cell + cols);
+		if(x > 0)
+			Func(Cell - 1);
+		if(Cell >= cols)
+			Func(Cell - cols);
+	}
 
-		std::vector<std::pair<int, int>> directions = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+	// Take the goal of a neighbour one step closer, which is final by the
+	// time a cell is settled at its own level.
+	void inheritOwner(int Cell)
+	{
+		forNeighbours(Cell, [&](int Neighbour) {
+			if(distance[Neighbour] + 1 == distance[Cell])
+				owner[Cell] = owner[Neighbour];
+		});
+	}
+
+	// A cell keeps its distance as long as a neighbour one step closer to
+	// the same goal still exists.
+	bool isSupported(int Cell) const
+	{
+		bool Supported = false;
+		forNeighbours(Cell, [&](int Neighbour) {
+			if(distance[Neighbour] + 1 == distance[Cell] && (owner.empty() || owner[Neighbour] == owner[Cell]))
+				Supported = true;
+		});
+		return Supported;
+	}
 
-		while(!pq.empty())
+	// Snapshot the grid into per-cell flags, so the search and findPath
+	// never have to look at the (row-allocated) source grid again.
+	void reset(const std::vector<std::vector<int>> &grid)
+	{
+		rows = grid.size();
+		cols = rows ? grid[0].size() : 0;
+		cells.resize(rows * cols);
+		distance.assign(rows * cols, UNREACHED);
+
+		for(int y = 0; y < rows; y++)
 		{
-			Node current = pq.top();
-			pq.pop();
+			const int *pRow = grid[y].data();
+			const int *pBelow = y < rows - 1 ? grid[y + 1].data() : nullptr;
+			uint8_t *pCells = &cells[index(y, 0)];
+			for(int x = 0; x < cols; x++)
+			{
+				uint8_t Flags = pRow[x] == 0 ? CELL_VALID : 0;
+				if(pBelow && (pRow[x] == -1 || pBelow[x] == -1))
+					Flags |= CELL_DANGEROUS;
+				pCells[x] = Flags;
+			}
+		}
+	}
 
-			int y = current.y;
-			int x = current.x;
-			double dist = current.dist;
+	// Classifies 64 tiles at a time straight from the bit planes.
+	void reset(const CTileLayer &layer, const std::vector<int> &danger)
+	{
+		rows = layer.Height();
+		cols = layer.Width();
+		cells.resize(rows * cols);
+		distance.assign(rows * cols, UNREACHED);
 
-			if(dist > distance[y][x])
+		for(int y = 0; y < rows; y++)
+		{
+			const uint64_t *pSolid = layer.Row(y, CTileLayer::PLANE_SOLID);
+			const uint64_t *pDeath = layer.Row(y, CTileLayer::PLANE_DEATH);
+			const uint64_t *pDeathBelow = y < rows - 1 ? layer.Row(y + 1, CTileLayer::PLANE_DEATH) : nullptr;
+			uint8_t *pCells = &cells[index(y, 0)];
+			for(int w = 0; w < layer.Words(); w++)
+			{
+				uint64_t Valid = ~(pSolid[w] | pDeath[w]);
+				uint64_t Dangerous = pDeathBelow ? pDeath[w] | pDeathBelow[w] : 0;
+				for(int b = 0, x = w * 64; b < 64 && x < cols; b++, x++)
+					pCells[x] = (Valid >> b & 1) * CELL_VALID | (Dangerous >> b & 1) * CELL_DANGEROUS;
+			}
+		}
+
+		// a danger cell is a death tile, which also endangers the tile above
+		for(int Cell : danger)
+		{
+			if(Cell < 0 || Cell >= rows * cols)
 				continue;
+			cells[Cell] = Cell < (rows - 1) * cols ? CELL_DANGEROUS : 0;
+			if(Cell >= cols)
+				cells[Cell - cols] |= CELL_DANGEROUS;
+		}
+	}
 
-			for(const auto &[dx, dy] : directions)
-			{
-				int nx = x + dx;
-				int ny = y + dy;
+	void search(std::pair<int, int> goal)
+	{
+		owner.clear();
+		frontier.clear();
+		int Goal = seed(goal.first, goal.second);
+		if(Goal >= 0 && backend != CBitWavefront::BACKEND_QUEUE)
+		{
+			// the wavefront keeps its bit planes per thread, not per field
+			static thread_local CBitWavefront s_Wavefront;
+			s_Wavefront.Fill(cells.data(), CELL_VALID, rows, cols, Goal, distance.data(), backend);
+			return;
+		}
+		bfs();
+	}
 
-				if(isValid(ny, nx) && !isDangerous(ny, nx) && dist + 1 < distance[ny][nx])
+	void search(const std::vector<std::pair<int, int>> &goals)
+	{
+		owner.assign(rows * cols, NO_GOAL);
+		frontier.clear();
+		for(size_t i = 0; i < goals.size() && i < NO_GOAL; i++)
+		{
+			int Cell = seed(goals[i].first, goals[i].second);
+			if(Cell >= 0 && owner[Cell] == NO_GOAL)
+				owner[Cell] = i;
+		}
+		bfs();
+	}
+
+	int seed(int goalY, int goalX)
+	{
+		if(!rows || !cols)
+			return -1;
+
+		int Goal = index(clamp(goalY, 0, rows - 1), clamp(goalX, 0, cols - 1));
+		if(distance[Goal] != 0)
+		{
+			distance[Goal] = 0;
+			frontier.push_back(Goal);
+		}
+		return Goal;
+	}
+
+	// Breadth-first search from every seeded goal at once.
+	void bfs()
+	{
+		for(size_t Head = 0; Head < frontier.size(); Head++)
+		{
+			int Current = frontier[Head];
+			int y = Current / cols;
+			int x = Current % cols;
+			uint16_t Next = distance[Current] + 1;
+			if(Next == UNREACHED)
+				continue;
+
+			auto Visit = [&](int Neighbour) {
+				if(cells[Neighbour] == CELL_VALID && Next < distance[Neighbour])
 				{
-					distance[ny][nx] = dist + 1;
-					pq.push(Node(ny, nx, distance[ny][nx]));
+					distance[Neighbour] = Next;
+					if(!owner.empty())
+						owner[Neighbour] = owner[Current];
+					frontier.push_back(Neighbour);
 				}
-			}
+			};
+
+			if(x + 1 < cols)
+				Visit(Current + 1);
+			if(y + 1 < rows)
+				Visit(Current + cols);
+			if(x > 0)
+				Visit(Current - 1);
+			if(y > 0)
+				Visit(Current - cols);
 		}
-
-		return distance;
 	}
 };
 
-#endif // ASTAR_H
\ No newline at end of file
+#endif // ASTAR_H
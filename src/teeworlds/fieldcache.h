@@ -0,0 +1,155 @@
+#ifndef TEEWORLDS_FIELDCACHE_H
+#define TEEWORLDS_FIELDCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include "astar.h"
+
+// Key of a cached distance field: the (clamped) goal tile plus the
+// generation of the danger overlay the field was computed against.
+struct SFieldKey
+{
+    int m_GoalY;
+    int m_GoalX;
+    uint64_t m_Generation;
+
+    bool operator==(const SFieldKey& Other) const
+    {
+        return m_GoalY == Other.m_GoalY && m_GoalX == Other.m_GoalX && m_Generation == Other.m_Generation;
+    }
+};
+
+struct SFieldKeyHash
+{
+    size_t operator()(const SFieldKey& Key) const
+    {
+        uint64_t Hash = (uint64_t) (uint32_t) Key.m_GoalY << 32 | (uint32_t) Key.m_GoalX;
+        Hash ^= Key.m_Generation * 0x9e3779b97f4a7c15ULL;
+        Hash ^= Hash >> 29;
+        return (size_t) (Hash * 0xbf58476d1ce4e5b9ULL);
+    }
+};
+
+// Least-recently-used cache of distance fields. An evicted entry hands its
+// buffers to the field that replaces it, so a full cache stops allocating.
+class CDistanceFieldCache
+{
+    struct SEntry
+    {
+        SFieldKey m_Key;
+        AStar m_Field;
+    };
+
+    std::list<SEntry> m_lEntries; // most recently used first
+    std::unordered_map<SFieldKey, std::list<SEntry>::iterator, SFieldKeyHash> m_Index;
+    size_t m_Capacity;
+
+    uint64_t m_Hits;
+    uint64_t m_Misses;
+    uint64_t m_Evictions;
+    uint64_t m_Repairs;
+
+public:
+    CDistanceFieldCache(size_t Capacity = 8) :
+        m_Capacity(Capacity > 0 ? Capacity : 1)
+    {
+        ResetStats();
+    }
+
+    void SetCapacity(size_t Capacity)
+    {
+        m_Capacity = Capacity > 0 ? Capacity : 1;
+        while(m_lEntries.size() > m_Capacity)
+        {
+            m_Index.erase(m_lEntries.back().m_Key);
+            m_lEntries.pop_back();
+        }
+    }
+
+    void Clear()
+    {
+        m_Index.clear();
+        m_lEntries.clear();
+    }
+
+    void ResetStats()
+    {
+        m_Hits = 0;
+        m_Misses = 0;
+        m_Evictions = 0;
+        m_Repairs = 0;
+    }
+
+    bool Contains(const SFieldKey& Key) const
+    {
+        return m_Index.count(Key);
+    }
+
+    AStar *Find(const SFieldKey& Key)
+    {
+        auto Iter = m_Index.find(Key);
+        if(Iter == m_Index.end())
+            return nullptr;
+
+        m_lEntries.splice(m_lEntries.begin(), m_lEntries, Iter->second);
+        return &Iter->second->m_Field;
+    }
+
+    // Returns the field for Key. On a miss Build(AStar &) is called to fill
+    // either a fresh entry or the recycled least recently used one.
+    template<typename FBuild>
+    AStar *Get(const SFieldKey& Key, FBuild&& Build)
+    {
+        if(AStar *pField = Find(Key))
+        {
+            m_Hits++;
+            return pField;
+        }
+        m_Misses++;
+
+        if(m_lEntries.size() >= m_Capacity)
+        {
+            m_Index.erase(m_lEntries.back().m_Key);
+            m_lEntries.splice(m_lEntries.begin(), m_lEntries, std::prev(m_lEntries.end()));
+            m_Evictions++;
+        }
+        else
+        {
+            m_lEntries.emplace_front();
+        }
+
+        SEntry& Entry = m_lEntries.front();
+        Entry.m_Key = Key;
+        Build(Entry.m_Field);
+        m_Index[Key] = m_lEntries.begin();
+        return &Entry.m_Field;
+    }
+
+    // Moves the field stored under From to To, for a caller that is about to
+    // repair it in place. Returns nullptr if From is gone or To is taken.
+    AStar *Rekey(const SFieldKey& From, const SFieldKey& To)
+    {
+        auto Iter = m_Index.find(From);
+        if(Iter == m_Index.end() || m_Index.count(To))
+            return nullptr;
+
+        auto Entry = Iter->second;
+        m_Index.erase(Iter);
+        m_lEntries.splice(m_lEntries.begin(), m_lEntries, Entry);
+        Entry->m_Key = To;
+        m_Index[To] = Entry;
+        m_Repairs++;
+        return &Entry->m_Field;
+    }
+
+    size_t Capacity() const { return m_Capacity; }
+    size_t Size() const { return m_lEntries.size(); }
+    uint64_t Hits() const { return m_Hits; }
+    uint64_t Misses() const { return m_Misses; }
+    uint64_t Evictions() const { return m_Evictions; }
+    uint64_t Repairs() const { return m_Repairs; }
+};
+
+#endif // TEEWORLDS_FIELDCACHE_H
@@ -0,0 +1,119 @@
+#include <include/base.h>
+
+#include <teeworlds/six/math.h>
+
+#include "astar.h"
+#include "flowfield.h"
+
+void CFlowField::Build(const AStar& Field)
+{
+    m_Rows = Field.getRows();
+    m_Cols = Field.getCols();
+    m_vFlow.resize((size_t) m_Rows * m_Cols);
+    for(int y = 0; y < m_Rows; y++)
+    {
+        for(int x = 0; x < m_Cols; x++)
+        {
+            // the move is stored as findPath returns it, hop included
+            uint8_t Flow = 0;
+            auto [dy, dx] = Field.nextMove(y, x);
+            if(dy != -1 || dx != -1)
+                Flow = 1 + (dy + 1) * 3 + dx + 1;
+            if(Field.isGoal(y, x))
+                Flow |= FLOW_GOAL;
+            if(Field.canStart(y, x))
+                Flow |= FLOW_START;
+            m_vFlow[(size_t) y * m_Cols + x] = Flow;
+        }
+    }
+}
+
+std::vector<std::pair<int, int>> CFlowField::FindPath(std::pair<int, int> Start, int MaxLength) const
+{
+    auto [y, x] = Start;
+    if(y < 0 || y >= m_Rows || x < 0 || x >= m_Cols)
+        return {};
+
+    uint8_t Flow = m_vFlow[(size_t) y * m_Cols + x];
+    if(!(Flow & FLOW_START) || (Flow & FLOW_GOAL))
+        return {};
+
+    std::vector<std::pair<int, int>> ret;
+    for(int i = 0; i < MaxLength; i++)
+    {
+        int Move = (Flow & FLOW_MOVE_MASK) - 1;
+        if(Move < 0)
+            break;
+
+        int dy = Move / 3 - 1;
+        int dx = Move % 3 - 1;
+        y += dy;
+        x += dx;
+        ret.push_back({dy, dx});
+        if(y < 0 || y >= m_Rows || x < 0 || x >= m_Cols)
+            break;
+
+        Flow = m_vFlow[(size_t) y * m_Cols + x];
+        if(Flow & FLOW_GOAL)
+            break;
+    }
+    return ret;
+}
+
+uint64_t SFlowKey::HashCells(const std::vector<int>& vCells)
+{
+    // FNV-1a
+    uint64_t Hash = 0xcbf29ce484222325ULL;
+    for(int Cell : vCells)
+    {
+        Hash ^= (uint32_t) Cell;
+        Hash *= 0x100000001b3ULL;
+    }
+    return Hash;
+}
+
+std::shared_ptr<const CFlowField> CFlowFieldService::Find(const SFlowKey& Key)
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    auto Iter = m_Fields.find(Key);
+    if(Iter == m_Fields.end())
+        return nullptr;
+
+    std::shared_ptr<const CFlowField> pField = Iter->second.lock();
+    if(pField)
+        m_Reused++;
+    return pField;
+}
+
+std::shared_ptr<const CFlowField> CFlowFieldService::Publish(const SFlowKey& Key, std::shared_ptr<CFlowField> pField)
+{
+    std::shared_ptr<const CFlowField> pExisting;
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        std::weak_ptr<const CFlowField>& Entry = m_Fields[Key];
+        pExisting = Entry.lock();
+        if(!pExisting)
+        {
+            Entry = pField;
+            m_Built++;
+            return pField;
+        }
+        m_Reused++;
+    }
+    // another bot was faster, pField is dropped outside the lock
+    return pExisting;
+}
+
+void CFlowFieldService::Forget(const SFlowKey& Key)
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    auto Iter = m_Fields.find(Key);
+    if(Iter != m_Fields.end() && Iter->second.expired())
+        m_Fields.erase(Iter);
+}
+
+size_t CFlowFieldService::Alive()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    return m_Fields.size();
+}
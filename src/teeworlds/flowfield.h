@@ -0,0 +1,116 @@
+#ifndef TEEWORLDS_FLOWFIELD_H
+#define TEEWORLDS_FLOWFIELD_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class AStar;
+
+// The move AStar::findPath would take from every tile, a byte per tile. A
+// path is then only a chain of lookups, and the field is a third of the
+// size of the distance field it was made from.
+class CFlowField
+{
+public:
+    CFlowField() :
+        m_Rows(0), m_Cols(0) {}
+
+    void Build(const AStar& Field);
+
+    // Same moves as AStar::findPath on the field it was built from.
+    std::vector<std::pair<int, int>> FindPath(std::pair<int, int> Start, int MaxLength = 30) const;
+
+    int Rows() const { return m_Rows; }
+    int Cols() const { return m_Cols; }
+    size_t MemoryUsage() const { return m_vFlow.size(); }
+
+private:
+    enum
+    {
+        FLOW_MOVE_MASK = 15, // 0 for none, else 1 + (dy + 1) * 3 + dx + 1
+        FLOW_GOAL = 1 << 4,
+        FLOW_START = 1 << 5, // a path may start here
+    };
+
+    int m_Rows;
+    int m_Cols;
+    std::vector<uint8_t> m_vFlow;
+};
+
+// Everything that identifies a flow field across bots: the map, the goal
+// tile and the danger cells it was computed against.
+struct SFlowKey
+{
+    uint64_t m_Map;
+    int m_GoalY;
+    int m_GoalX;
+    uint64_t m_Overlay; // hash of the danger cells
+
+    bool operator==(const SFlowKey& Other) const
+    {
+        return m_Map == Other.m_Map && m_GoalY == Other.m_GoalY && m_GoalX == Other.m_GoalX && m_Overlay == Other.m_Overlay;
+    }
+
+    static uint64_t HashCells(const std::vector<int>& vCells);
+};
+
+struct SFlowKeyHash
+{
+    size_t operator()(const SFlowKey& Key) const
+    {
+        uint64_t Hash = Key.m_Map ^ Key.m_Overlay * 0x9e3779b97f4a7c15ULL;
+        Hash ^= (uint64_t) (uint32_t) Key.m_GoalY << 32 | (uint32_t) Key.m_GoalX;
+        Hash ^= Hash >> 29;
+        return (size_t) (Hash * 0xbf58476d1ce4e5b9ULL);
+    }
+};
+
+// Flow fields shared read-only by every bot of the process. The first bot
+// that needs a field builds it, the others get the same one, and it is
+// freed when the last bot lets go of it.
+class CFlowFieldService
+{
+public:
+    CFlowFieldService() :
+        m_Built(0), m_Reused(0) {}
+
+    // nullptr if nobody holds the field right now
+    std::shared_ptr<const CFlowField> Find(const SFlowKey& Key);
+
+    // The field for Key. On a miss Build(CFlowField &) fills a new one,
+    // outside the lock; of two bots racing for it the first one wins.
+    template<typename FBuild>
+    std::shared_ptr<const CFlowField> Acquire(const SFlowKey& Key, FBuild&& Build)
+    {
+        if(std::shared_ptr<const CFlowField> pField = Find(Key))
+            return pField;
+
+        std::shared_ptr<CFlowField> pNew(new CFlowField(), [this, Key](CFlowField *pField)
+        {
+            delete pField;
+            Forget(Key);
+        });
+        Build(*pNew);
+        return Publish(Key, std::move(pNew));
+    }
+
+    size_t Alive();
+    uint64_t Built() const { return m_Built; }
+    uint64_t Reused() const { return m_Reused; }
+
+private:
+    std::mutex m_Mutex;
+    std::unordered_map<SFlowKey, std::weak_ptr<const CFlowField>, SFlowKeyHash> m_Fields;
+    std::atomic<uint64_t> m_Built;
+    std::atomic<uint64_t> m_Reused;
+
+    std::shared_ptr<const CFlowField> Publish(const SFlowKey& Key, std::shared_ptr<CFlowField> pField);
+    void Forget(const SFlowKey& Key);
+};
+
+#endif // TEEWORLDS_FLOWFIELD_H
@@ -0,0 +1,403 @@
+#include <include/base.h>
+
+#include <teeworlds/six/math.h>
+
+#include "landmarks.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+
+static const char s_aLandmarkMagic[4] = {'S', 'A', 'L', 'T'};
+static const int s_LandmarkVersion = 1;
+
+struct SLandmarkHeader
+{
+    char m_aMagic[4];
+    int32_t m_Version;
+    int32_t m_Rows;
+    int32_t m_Cols;
+    int32_t m_Count;
+    uint64_t m_GridHash;
+};
+
+CLandmarks::CLandmarks()
+{
+    m_Stamp = 0;
+    Clear();
+}
+
+void CLandmarks::Clear()
+{
+    m_Rows = 0;
+    m_Cols = 0;
+    m_GridHash = 0;
+    m_LastExpanded = 0;
+    m_vOpen.clear();
+    m_vLandmarks.clear();
+    m_vDistance.clear();
+}
+
+uint64_t CLandmarks::HashGrid(const std::vector<uint8_t>& vOpen, int Rows, int Cols)
+{
+    // FNV-1a over the size and the open tiles
+    uint64_t Hash = 0xcbf29ce484222325ULL;
+    auto Mix = [&](uint64_t Value)
+    {
+        Hash ^= Value;
+        Hash *= 0x100000001b3ULL;
+    };
+    Mix(Rows);
+    Mix(Cols);
+    for(uint8_t Open : vOpen)
+        Mix(Open);
+    return Hash;
+}
+
+void CLandmarks::Fill(int Landmark, std::vector<uint16_t>& vDistance)
+{
+    vDistance.assign(m_Rows * m_Cols, UNREACHED);
+    uint16_t *pDistance = vDistance.data();
+
+    m_vQueue.clear();
+    pDistance[Landmark] = 0;
+    m_vQueue.push_back(Landmark);
+    for(size_t Head = 0; Head < m_vQueue.size(); Head++)
+    {
+        int Current = m_vQueue[Head];
+        int x = Current % m_Cols;
+        uint16_t Next = pDistance[Current] + 1;
+        if(Next == UNREACHED)
+            continue;
+
+        auto Visit = [&](int Neighbour)
+        {
+            if(m_vOpen[Neighbour] && Next < pDistance[Neighbour])
+            {
+                pDistance[Neighbour] = Next;
+                m_vQueue.push_back(Neighbour);
+            }
+        };
+
+        if(x + 1 < m_Cols)
+            Visit(Current + 1);
+        if(Current + m_Cols < m_Rows * m_Cols)
+            Visit(Current + m_Cols);
+        if(x > 0)
+            Visit(Current - 1);
+        if(Current >= m_Cols)
+            Visit(Current - m_Cols);
+    }
+}
+
+bool CLandmarks::AddLandmark(int Cell)
+{
+    if((int) m_vLandmarks.size() >= MAX_LANDMARKS || Cell < 0 || Cell >= m_Rows * m_Cols || !m_vOpen[Cell])
+        return false;
+    if(std::find(m_vLandmarks.begin(), m_vLandmarks.end(), Cell) != m_vLandmarks.end())
+        return false;
+
+    // the search scratch holds the new column while the table is widened
+    Fill(Cell, m_vCost);
+    size_t Cells = (size_t) m_Rows * m_Cols;
+    size_t Count = m_vLandmarks.size();
+    std::vector<uint16_t> vDistance(Cells * (Count + 1));
+    for(size_t i = 0; i < Cells; i++)
+    {
+        std::copy_n(&m_vDistance[i * Count], Count, &vDistance[i * (Count + 1)]);
+        vDistance[i * (Count + 1) + Count] = m_vCost[i];
+    }
+    m_vDistance.swap(vDistance);
+    m_vLandmarks.push_back(Cell);
+    return true;
+}
+
+void CLandmarks::Build(const CPathGrid& Grid)
+{
+    Clear();
+    m_Rows = Grid.Rows();
+    m_Cols = Grid.Cols();
+    m_vOpen.resize(m_Rows * m_Cols);
+    for(int Cell = 0; Cell < m_Rows * m_Cols; Cell++)
+        m_vOpen[Cell] = Grid.IsOpen(Cell);
+    m_GridHash = HashGrid(m_vOpen, m_Rows, m_Cols);
+
+    // the open tile closest to every corner
+    const int aCorners[4][2] = {{0, 0}, {0, m_Cols - 1}, {m_Rows - 1, 0}, {m_Rows - 1, m_Cols - 1}};
+    for(const auto& Corner : aCorners)
+    {
+        int Best = -1;
+        int BestDistance = 0;
+        for(int Cell = 0; Cell < m_Rows * m_Cols; Cell++)
+        {
+            if(!m_vOpen[Cell])
+                continue;
+            int Distance = std::abs(Cell / m_Cols - Corner[0]) + std::abs(Cell % m_Cols - Corner[1]);
+            if(Best < 0 || Distance < BestDistance)
+            {
+                Best = Cell;
+                BestDistance = Distance;
+            }
+        }
+        AddLandmark(Best);
+    }
+
+    // then the reached tile that is furthest from every landmark so far
+    while(NumLandmarks() > 0 && NumLandmarks() < NUM_BASE_LANDMARKS)
+    {
+        int Best = -1;
+        int BestDistance = 0;
+        for(int Cell = 0; Cell < m_Rows * m_Cols; Cell++)
+        {
+            int Nearest = UNREACHED;
+            for(int i = 0; i < NumLandmarks(); i++)
+                Nearest = std::min<int>(Nearest, m_vDistance[(size_t) Cell * NumLandmarks() + i]);
+            if(Nearest != UNREACHED && Nearest > BestDistance)
+            {
+                Best = Cell;
+                BestDistance = Nearest;
+            }
+        }
+        if(!AddLandmark(Best))
+            break;
+    }
+}
+
+bool CLandmarks::Load(std::span<const char> Data, const CPathGrid& Grid)
+{
+    SLandmarkHeader Header;
+    if(Data.size() < sizeof(Header))
+        return false;
+    memcpy(&Header, Data.data(), sizeof(Header));
+    if(memcmp(Header.m_aMagic, s_aLandmarkMagic, sizeof(Header.m_aMagic)) || Header.m_Version != s_LandmarkVersion ||
+        Header.m_Rows != Grid.Rows() || Header.m_Cols != Grid.Cols() || Header.m_Count < 0 || Header.m_Count > MAX_LANDMARKS)
+        return false;
+
+    size_t Cells = (size_t) Header.m_Rows * Header.m_Cols;
+    if(Data.size() != sizeof(Header) + Header.m_Count * sizeof(int32_t) + Header.m_Count * Cells * sizeof(uint16_t))
+        return false;
+
+    std::vector<uint8_t> vOpen(Cells);
+    for(size_t Cell = 0; Cell < Cells; Cell++)
+        vOpen[Cell] = Grid.IsOpen(Cell);
+    if(HashGrid(vOpen, Header.m_Rows, Header.m_Cols) != Header.m_GridHash)
+        return false;
+
+    Clear();
+    m_Rows = Header.m_Rows;
+    m_Cols = Header.m_Cols;
+    m_GridHash = Header.m_GridHash;
+    m_vOpen = std::move(vOpen);
+
+    const char *pData = Data.data() + sizeof(Header);
+    m_vLandmarks.resize(Header.m_Count);
+    for(int i = 0; i < Header.m_Count; i++)
+    {
+        int32_t Cell;
+        memcpy(&Cell, pData, sizeof(Cell));
+        pData += sizeof(Cell);
+        m_vLandmarks[i] = Cell;
+    }
+    m_vDistance.resize(Header.m_Count * Cells);
+    memcpy(m_vDistance.data(), pData, m_vDistance.size() * sizeof(uint16_t));
+    return true;
+}
+
+void CLandmarks::Save(std::vector<char>& vData) const
+{
+    SLandmarkHeader Header;
+    memcpy(Header.m_aMagic, s_aLandmarkMagic, sizeof(Header.m_aMagic));
+    Header.m_Version = s_LandmarkVersion;
+    Header.m_Rows = m_Rows;
+    Header.m_Cols = m_Cols;
+    Header.m_Count = m_vLandmarks.size();
+    Header.m_GridHash = m_GridHash;
+
+    vData.resize(sizeof(Header) + m_vLandmarks.size() * sizeof(int32_t) + m_vDistance.size() * sizeof(uint16_t));
+    char *pData = vData.data();
+    memcpy(pData, &Header, sizeof(Header));
+    pData += sizeof(Header);
+    for(int Landmark : m_vLandmarks)
+    {
+        int32_t Cell = Landmark;
+        memcpy(pData, &Cell, sizeof(Cell));
+        pData += sizeof(Cell);
+    }
+    memcpy(pData, m_vDistance.data(), m_vDistance.size() * sizeof(uint16_t));
+}
+
+int CLandmarks::LowerBound(int From, int To) const
+{
+    int Bound = 0;
+    size_t Count = m_vLandmarks.size();
+    const uint16_t *pFrom = &m_vDistance[From * Count];
+    const uint16_t *pTo = &m_vDistance[To * Count];
+    for(size_t i = 0; i < Count; i++)
+    {
+        int DistanceFrom = pFrom[i];
+        int DistanceTo = pTo[i];
+        if(DistanceFrom == UNREACHED && DistanceTo == UNREACHED)
+            continue;
+        if(DistanceFrom == UNREACHED || DistanceTo == UNREACHED)
+            return UNREACHED; // one of them is cut off from the other
+        Bound = std::max(Bound, std::abs(DistanceFrom - DistanceTo));
+    }
+    return Bound;
+}
+
+std::vector<std::pair<int, int>> CLandmarks::FindPath(const CPathGrid& Grid, std::pair<int, int> Start, std::pair<int, int> Goal, int MaxLength)
+{
+    m_LastExpanded = 0;
+    if(Grid.Rows() != m_Rows || Grid.Cols() != m_Cols || !Grid.Loaded())
+        return {};
+
+    auto [StartY, StartX] = Start;
+    if(!Grid.Inside(StartY, StartX) || (!Grid.IsOpen(StartY, StartX) && !Grid.IsDangerous(StartY, StartX)))
+        return {}; // Start is invalid
+
+    int GoalY = clamp(Goal.first, 0, m_Rows - 1);
+    int GoalX = clamp(Goal.second, 0, m_Cols - 1);
+    int GoalCell = GoalY * m_Cols + GoalX;
+    int StartCell = StartY * m_Cols + StartX;
+    if(StartCell == GoalCell)
+        return {};
+
+    static const std::pair<int, int> s_aDirections[] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+
+    // a closed goal has no table entries, bound through its open neighbours.
+    // Tiles open now were open when the tables were built.
+    int aTargets[4];
+    int NumTargets = 0;
+    int TargetOffset = 0;
+    if(m_vOpen[GoalCell])
+        aTargets[NumTargets++] = GoalCell;
+    else
+    {
+        TargetOffset = 1;
+        for(const auto& [dy, dx] : s_aDirections)
+        {
+            if(Grid.IsOpen(GoalY + dy, GoalX + dx))
+                aTargets[NumTargets++] = (GoalY + dy) * m_Cols + GoalX + dx;
+        }
+        // walled in, nothing steps into it
+        if(!NumTargets)
+            return {};
+    }
+
+    auto Heuristic = [&](int Cell)
+    {
+        int Bound = std::abs(Cell / m_Cols - GoalY) + std::abs(Cell % m_Cols - GoalX);
+        if(Cell == GoalCell)
+            return Bound;
+
+        int Landmark = UNREACHED;
+        for(int i = 0; i < NumTargets; i++)
+        {
+            int Target = LowerBound(Cell, aTargets[i]);
+            if(Target != UNREACHED)
+                Landmark = std::min(Landmark, Target + TargetOffset);
+        }
+        return Landmark == UNREACHED ? (int) UNREACHED : std::max(Bound, Landmark);
+    };
+
+    if(Heuristic(StartCell) == UNREACHED)
+        return {};
+
+    size_t Cells = (size_t) m_Rows * m_Cols;
+    if(m_vStamp.size() != Cells)
+    {
+        m_vCost.assign(Cells, UNREACHED);
+        m_vStamp.assign(Cells, 0);
+        m_vParent.assign(Cells, 0);
+    }
+    if(++m_Stamp == 0)
+    {
+        std::fill(m_vStamp.begin(), m_vStamp.end(), 0);
+        m_Stamp = 1;
+    }
+
+    struct SEntry
+    {
+        int m_Estimate;
+        int m_Cost;
+        int m_Cell;
+
+        // smallest estimate first, the deeper entry on ties
+        bool operator<(const SEntry& Other) const
+        {
+            return m_Estimate != Other.m_Estimate ? m_Estimate > Other.m_Estimate : m_Cost < Other.m_Cost;
+        }
+    };
+
+    std::priority_queue<SEntry> Queue;
+    m_vCost[StartCell] = 0;
+    m_vStamp[StartCell] = m_Stamp;
+    Queue.push({Heuristic(StartCell), 0, StartCell});
+
+    bool Found = false;
+    while(!Queue.empty())
+    {
+        SEntry Entry = Queue.top();
+        Queue.pop();
+        if(Entry.m_Cost != m_vCost[Entry.m_Cell])
+            continue;
+        if(Entry.m_Cell == GoalCell)
+        {
+            Found = true;
+            break;
+        }
+        m_LastExpanded++;
+
+        int y = Entry.m_Cell / m_Cols;
+        int x = Entry.m_Cell % m_Cols;
+        for(int Direction = 0; Direction < 4; Direction++)
+        {
+            int ny = y + s_aDirections[Direction].first;
+            int nx = x + s_aDirections[Direction].second;
+            int Neighbour = ny * m_Cols + nx;
+            if(!Grid.Inside(ny, nx) || (Neighbour != GoalCell && !Grid.IsOpen(ny, nx)))
+                continue;
+
+            int Cost = Entry.m_Cost + 1;
+            if(Cost >= UNREACHED || (m_vStamp[Neighbour] == m_Stamp && m_vCost[Neighbour] <= Cost))
+                continue;
+            int Estimate = Heuristic(Neighbour);
+            if(Estimate == UNREACHED)
+                continue;
+
+            m_vStamp[Neighbour] = m_Stamp;
+            m_vCost[Neighbour] = Cost;
+            m_vParent[Neighbour] = Direction;
+            Queue.push({Cost + Estimate, Cost, Neighbour});
+        }
+    }
+    if(!Found)
+        return {};
+
+    std::vector<int> vDirections;
+    for(int Cell = GoalCell; Cell != StartCell;)
+    {
+        int Direction = m_vParent[Cell];
+        vDirections.push_back(Direction);
+        Cell -= s_aDirections[Direction].first * m_Cols + s_aDirections[Direction].second;
+    }
+    std::reverse(vDirections.begin(), vDirections.end());
+
+    std::vector<std::pair<int, int>> ret;
+    int y = StartY;
+    int x = StartX;
+    for(int Direction : vDirections)
+    {
+        if((int) ret.size() >= MaxLength)
+            break;
+        auto [dy, dx] = s_aDirections[Direction];
+        y += dy;
+        x += dx;
+        std::pair<int, int> Move = {dy, dx};
+        if(Grid.IsDangerous(y + 1, x))
+            Move.first = -1;
+        ret.push_back(Move);
+    }
+    return ret;
+}
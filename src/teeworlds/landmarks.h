@@ -0,0 +1,72 @@
+#ifndef TEEWORLDS_LANDMARKS_H
+#define TEEWORLDS_LANDMARKS_H
+
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "pathgrid.h"
+
+// Landmark tables for goal-directed search (ALT). Every landmark stores its
+// walking distance to every tile; by the triangle inequality
+// |d(L, a) - d(L, b)| never overestimates the distance from a to b, which
+// makes a much better A* heuristic than the tile distance alone. Tables
+// are computed on the map without the danger overlay. Danger only closes
+// tiles, so the bounds stay admissible while lasers are around.
+class CLandmarks
+{
+public:
+    enum
+    {
+        NUM_BASE_LANDMARKS = 8, // corners, then the tiles furthest from those
+        MAX_LANDMARKS = 16,
+    };
+
+    static constexpr uint16_t UNREACHED = 0xffff;
+
+    CLandmarks();
+
+    void Build(const CPathGrid& Grid);
+    void Clear();
+    // Adds a landmark at Cell, like a stronghold. False if there is no room
+    // left, the tile is closed or it is a landmark already.
+    bool AddLandmark(int Cell);
+
+    // Serialized tables, rejected if they were computed for another grid.
+    bool Load(std::span<const char> Data, const CPathGrid& Grid);
+    void Save(std::vector<char>& vData) const;
+
+    // Lower bound of the walking distance between two tiles, UNREACHED if
+    // they are not connected at all.
+    int LowerBound(int From, int To) const;
+
+    // Point-to-point A* on the current grid, same move format as
+    // AStar::findPath.
+    std::vector<std::pair<int, int>> FindPath(const CPathGrid& Grid, std::pair<int, int> Start, std::pair<int, int> Goal, int MaxLength = 30);
+
+    int NumLandmarks() const { return m_vLandmarks.size(); }
+    int LastExpanded() const { return m_LastExpanded; }
+
+private:
+    int m_Rows;
+    int m_Cols;
+    uint64_t m_GridHash;
+    std::vector<uint8_t> m_vOpen; // the grid the tables were computed on
+    std::vector<int> m_vLandmarks;
+    std::vector<uint16_t> m_vDistance; // all landmarks of a tile next to each other
+
+    // scratch space of the searches
+    std::vector<int> m_vQueue;
+    std::vector<uint16_t> m_vCost;
+    std::vector<uint32_t> m_vStamp;
+    std::vector<uint8_t> m_vParent;
+    uint32_t m_Stamp;
+    int m_LastExpanded;
+
+    static uint64_t HashGrid(const std::vector<uint8_t>& vOpen, int Rows, int Cols);
+    // walking distances from the tile Landmark on the static grid
+    void Fill(int Landmark, std::vector<uint16_t>& vDistance);
+};
+
+#endif // TEEWORLDS_LANDMARKS_H
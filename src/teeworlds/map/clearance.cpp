@@ -0,0 +1,84 @@
+#include <include/base.h>
+
+#include <teeworlds/six/math.h>
+
+#include "clearance.h"
+
+#include <algorithm>
+
+void CClearanceField::Build(const CTileLayer& Layer)
+{
+    m_Width = Layer.Width();
+    m_Height = Layer.Height();
+    m_vDistance.assign((size_t) m_Width * m_Height, MAX_DISTANCE);
+    if(!m_Width || !m_Height)
+        return;
+
+    for(int y = 0; y < m_Height; y++)
+        for(int x = 0; x < m_Width; x++)
+            if(Layer.Check(x, y, ESMapItems::TILEFLAG_SOLID))
+                m_vDistance[(size_t) y * m_Width + x] = 0;
+
+    // Two passes over the eight neighbours give the exact distance along the
+    // larger axis. Tiles outside the map repeat the edge, and are never
+    // nearer than the edge tile they repeat.
+    auto Relax = [&](int x, int y, int dx, int dy) {
+        uint8_t& Distance = m_vDistance[(size_t) y * m_Width + x];
+        for(int Offset = -1; Offset <= 1; Offset++)
+        {
+            int nx = dy ? x + Offset : x + dx;
+            int ny = dy ? y + dy : y + Offset;
+            if(nx >= 0 && nx < m_Width && ny >= 0 && ny < m_Height)
+                Distance = std::min<int>(Distance, m_vDistance[(size_t) ny * m_Width + nx] + 1);
+        }
+    };
+    for(int y = 0; y < m_Height; y++)
+    {
+        for(int x = 0; x < m_Width; x++)
+        {
+            Relax(x, y, 0, -1);
+            Relax(x, y, -1, 0);
+        }
+    }
+    for(int y = m_Height - 1; y >= 0; y--)
+    {
+        for(int x = m_Width - 1; x >= 0; x--)
+        {
+            Relax(x, y, 0, 1);
+            Relax(x, y, 1, 0);
+        }
+    }
+}
+
+void CClearanceField::Clear()
+{
+    m_Width = 0;
+    m_Height = 0;
+    m_vDistance.clear();
+}
+
+int CClearanceField::TileDistance(int TileX, int TileY) const
+{
+    return m_vDistance[(size_t) clamp(TileY, 0, m_Height - 1) * m_Width + clamp(TileX, 0, m_Width - 1)];
+}
+
+float CClearanceField::Clearance(vec2 Pos) const
+{
+    // CheckPoint rounds to whole pixels and truncates towards zero, so tile
+    // 0 is 63 pixels wide. A point can move 32 * (Distance - 1) pixels, less
+    // one for the rounding, before it may round into a tile further away.
+    int X = round_to_int(Pos.x);
+    int Y = round_to_int(Pos.y);
+    int TileX = X / 32;
+    int TileY = Y / 32;
+    int Distance = TileDistance(TileX, TileY);
+    if(!Distance)
+        return -1.0f;
+
+    // past the origin the point may also use the room left to the edges of
+    // its own tile
+    int Inner = 0;
+    if(X >= 0 && Y >= 0)
+        Inner = std::min(std::min(X & 31, 31 - (X & 31)), std::min(Y & 31, 31 - (Y & 31)));
+    return 32.0f * (Distance - 1) + Inner - 1.0f;
+}
@@ -0,0 +1,43 @@
+#ifndef TEEWORLDS_MAP_CLEARANCE_H
+#define TEEWORLDS_MAP_CLEARANCE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <teeworlds/six/vmath.h>
+
+#include "tilelayer.h"
+
+// Distance from every tile to the nearest solid tile, counted in tiles along
+// the larger axis (0 for solid tiles). Points are looked up the way
+// CCollision::CheckPoint maps them to tiles, so Clearance() is safe to use
+// for skipping point tests.
+class CClearanceField
+{
+public:
+    static constexpr int MAX_DISTANCE = 255;
+
+    CClearanceField() :
+        m_Width(0), m_Height(0) {}
+
+    void Build(const CTileLayer& Layer);
+    void Clear();
+
+    bool Loaded() const { return m_Width > 0; }
+    size_t MemoryUsage() const { return m_vDistance.size(); }
+
+    // clamped to the map like the tiles themselves
+    int TileDistance(int TileX, int TileY) const;
+
+    // Pixels a point may move along either axis without reaching a solid
+    // tile, negative inside one. Within the map this also counts how far
+    // the point lies from the edges of its own tile.
+    float Clearance(vec2 Pos) const;
+
+private:
+    int m_Width;
+    int m_Height;
+    std::vector<uint8_t> m_vDistance;
+};
+
+#endif // TEEWORLDS_MAP_CLEARANCE_H
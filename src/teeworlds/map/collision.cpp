@@ -0,0 +1,248 @@
+#include <include/base.h>
+
+#include <teeworlds/six/math.h>
+
+#include "collision.h"
+
+#include <algorithm>
+#include <cmath>
+
+CCollision::CCollision() :
+    m_pLayer(nullptr), m_pClearance(nullptr)
+{
+}
+
+void CCollision::Init(const CTileLayer *pLayer, const CClearanceField *pClearance)
+{
+    m_pLayer = pLayer;
+    m_pClearance = pClearance && pClearance->Loaded() ? pClearance : nullptr;
+}
+
+ESMapItems CCollision::GetTileAt(int TileX, int TileY) const
+{
+    return m_pLayer->GetTile(TileX, TileY);
+}
+
+ESMapItems CCollision::GetTile(float X, float Y) const
+{
+    return GetTileAt(round_to_int(X) / 32, round_to_int(Y) / 32);
+}
+
+bool CCollision::IsGrounded(float X, float Y) const
+{
+    // both feet lie in the same or in neighbouring tiles
+    return m_pLayer->RowSpan(round_to_int(Y + 19.f) / 32, round_to_int(X - 14.f) / 32, round_to_int(X + 14.f) / 32, ESMapItems::TILEFLAG_SOLID);
+}
+
+ESMapItems CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
+{
+    float Distance = distance(Pos0, Pos1);
+    int End(Distance+1);
+
+    // The line is sampled once per pixel of its length and the first sample
+    // on a solid tile is the hit. Instead of testing every sample, the tiles
+    // the line crosses are walked in order (Amanatides & Woo) and each is
+    // looked up once. The samples well inside a tile share its tile, only
+    // those within rounding distance of a tile edge are tested one by one.
+    auto Hit = [&](int i)
+    {
+        vec2 Pos = mix(Pos0, Pos1, i/Distance);
+        if(!CheckPoint(Pos.x, Pos.y))
+            return ESMapItems::TILEFLAG_AIR;
+        if(pOutCollision)
+            *pOutCollision = Pos;
+        if(pOutBeforeCollision)
+            *pOutBeforeCollision = i > 0 ? mix(Pos0, Pos1, (i-1)/Distance) : Pos0;
+        return GetTile(Pos.x, Pos.y);
+    };
+
+    int i = 0;
+    // tiles start at pixel 32k - 0.5 this side of zero, short lines are not
+    // worth the setup
+    if(End > 4 && std::min({Pos0.x, Pos0.y, Pos1.x, Pos1.y}) >= 0.0f && std::max({Pos0.x, Pos0.y, Pos1.x, Pos1.y}) < 1e6f)
+    {
+        // far more than the rounding of a sample, far less than a pixel
+        const double Margin = 1.0 / 64.0;
+        double X0 = Pos0.x + 0.5, Y0 = Pos0.y + 0.5;
+        double DX = (double) Pos1.x - Pos0.x, DY = (double) Pos1.y - Pos0.y;
+        int TileX = (int) (X0 / 32), TileY = (int) (Y0 / 32);
+        int StepX = DX > 0 ? 1 : -1, StepY = DY > 0 ? 1 : -1;
+        double DeltaX = DX != 0 ? 32 / std::abs(DX) : INFINITY;
+        double DeltaY = DY != 0 ? 32 / std::abs(DY) : INFINITY;
+        double NextX = DX != 0 ? ((TileX + (DX > 0)) * 32 - X0) / DX : INFINITY;
+        double NextY = DY != 0 ? ((TileY + (DY > 0)) * 32 - Y0) / DY : INFINITY;
+
+        // the part of the line well inside tiles First..Last of one axis
+        auto Inside = [Margin](double Start, double Delta, int First, int Last, double& Enter, double& Leave)
+        {
+            double Low = First * 32 + Margin, High = Last * 32 + 32 - Margin;
+            if(Delta == 0)
+            {
+                if(Start < Low || Start > High)
+                    Enter = INFINITY;
+                return;
+            }
+            double t0 = (Low - Start) / Delta, t1 = (High - Start) / Delta;
+            Enter = std::max(Enter, std::min(t0, t1));
+            Leave = std::min(Leave, std::max(t0, t1));
+        };
+
+        while(i < End)
+        {
+            // with a clearance field the free tiles around this one are
+            // passed as one square
+            int Radius = 0;
+            bool Solid;
+            if(m_pClearance)
+            {
+                Radius = m_pClearance->TileDistance(TileX, TileY) - 1;
+                Solid = Radius < 0;
+                Radius = std::max(Radius, 0);
+            }
+            else
+                Solid = m_pLayer->Check(TileX, TileY, ESMapItems::TILEFLAG_SOLID);
+
+            double Enter = 0, Leave = 1;
+            Inside(X0, DX, TileX - Radius, TileX + Radius, Enter, Leave);
+            Inside(Y0, DY, TileY - Radius, TileY + Radius, Enter, Leave);
+            int First = (int) std::min(std::ceil(Enter * Distance), (double) End);
+            int Last = (int) std::min(std::floor(Leave * Distance), (double) End - 1);
+
+            // samples near the edges of the square
+            for(; i < First; i++)
+                if(ESMapItems Tile = Hit(i); Tile != ESMapItems::TILEFLAG_AIR)
+                    return Tile;
+            if(First <= Last)
+            {
+                if(Solid)
+                    if(ESMapItems Tile = Hit(First); Tile != ESMapItems::TILEFLAG_AIR)
+                        return Tile;
+                i = std::max(i, Last + 1);
+            }
+
+            // on to the first tile out of the square
+            int CenterX = TileX, CenterY = TileY;
+            while(std::abs(TileX - CenterX) <= Radius && std::abs(TileY - CenterY) <= Radius && std::min(NextX, NextY) < 1)
+            {
+                if(NextX < NextY)
+                {
+                    TileX += StepX;
+                    NextX += DeltaX;
+                }
+                else
+                {
+                    TileY += StepY;
+                    NextY += DeltaY;
+                }
+            }
+            // the line ends in the square
+            if(std::abs(TileX - CenterX) <= Radius && std::abs(TileY - CenterY) <= Radius)
+                break;
+        }
+    }
+
+    for(; i < End; i++)
+        if(ESMapItems Tile = Hit(i); Tile != ESMapItems::TILEFLAG_AIR)
+            return Tile;
+    if(pOutCollision)
+        *pOutCollision = Pos1;
+    if(pOutBeforeCollision)
+        *pOutBeforeCollision = Pos1;
+    return ESMapItems::TILEFLAG_AIR;
+}
+
+void CCollision::IntersectLines(const vec2 *pFrom, const vec2 *pTo, int Num, SLineHit *pHits) const
+{
+    for(int i = 0; i < Num; i++)
+        pHits[i].m_Tile = IntersectLine(pFrom[i], pTo[i], &pHits[i].m_Collision, &pHits[i].m_BeforeCollision);
+}
+
+bool CCollision::TestBox(vec2 Pos, vec2 Size) const
+{
+    // A box less than a tile wide spans at most two tiles each way, so its
+    // corners cover every tile it touches.
+    if(Size.x <= 30.f && Size.y <= 30.f)
+    {
+        Size *= 0.5f;
+        return m_pLayer->Box(round_to_int(Pos.x - Size.x) / 32, round_to_int(Pos.y - Size.y) / 32, round_to_int(Pos.x + Size.x) / 32, round_to_int(Pos.y + Size.y) / 32, ESMapItems::TILEFLAG_SOLID);
+    }
+
+    Size *= 0.5f;
+    if(CheckPoint(Pos.x-Size.x, Pos.y-Size.y))
+        return true;
+    if(CheckPoint(Pos.x+Size.x, Pos.y-Size.y))
+        return true;
+    if(CheckPoint(Pos.x-Size.x, Pos.y+Size.y))
+        return true;
+    if(CheckPoint(Pos.x+Size.x, Pos.y+Size.y))
+        return true;
+    return false;
+}
+
+void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity) const
+{
+    // do the move
+    vec2 Pos = *pInoutPos;
+    vec2 Vel = *pInoutVel;
+
+    float Distance = length(Vel);
+    int Max = (int)Distance;
+
+    if(Distance > 0.00001f)
+    {
+        float Fraction = 1.0f/(float)(Max+1);
+        float HalfSize = std::max(Size.x, Size.y) * 0.5f;
+        for(int i = 0; i <= Max; i++)
+        {
+            // steps that keep the box inside the clearance of its centre
+            // cannot hit anything, move them without testing
+            if(m_pClearance)
+            {
+                vec2 Step = Vel*Fraction;
+                float StepSize = std::max(absolute(Step.x), absolute(Step.y));
+                float Room = m_pClearance->Clearance(Pos) - HalfSize - 1.0f;
+                int Free = StepSize > 0.0f ? (int) std::min(Room / StepSize, (float) (Max + 1)) : (Room >= 0.0f ? Max + 1 : 0);
+                for(int End = std::min(i + Free, Max + 1); i < End; i++)
+                    Pos = Pos + Vel*Fraction;
+                if(i > Max)
+                    break;
+            }
+
+            vec2 NewPos = Pos + Vel*Fraction; // TODO: this row is not nice
+
+            if(TestBox(vec2(NewPos.x, NewPos.y), Size))
+            {
+                int Hits = 0;
+
+                if(TestBox(vec2(Pos.x, NewPos.y), Size))
+                {
+                    NewPos.y = Pos.y;
+                    Vel.y *= -Elasticity;
+                    Hits++;
+                }
+
+                if(TestBox(vec2(NewPos.x, Pos.y), Size))
+                {
+                    NewPos.x = Pos.x;
+                    Vel.x *= -Elasticity;
+                    Hits++;
+                }
+
+                // neither of the tests got a collision.
+                // this is a real _corner case_!
+                if(Hits == 0)
+                {
+                    NewPos.y = Pos.y;
+                    Vel.y *= -Elasticity;
+                    NewPos.x = Pos.x;
+                    Vel.x *= -Elasticity;
+                }
+            }
+
+            Pos = NewPos;
+        }
+    }
+
+    *pInoutPos = Pos;
+    *pInoutVel = Vel;
+}
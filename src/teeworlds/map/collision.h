@@ -0,0 +1,52 @@
+#ifndef TEEWORLDS_MAP_COLLISION_H
+#define TEEWORLDS_MAP_COLLISION_H
+
+#include <teeworlds/six/math.h>
+#include <teeworlds/six/vmath.h>
+
+#include "clearance.h"
+#include "convert.h"
+#include "tilelayer.h"
+
+// Read-only collision queries over the converted game layer. The tile
+// layer is owned by whoever loaded the map, as is the optional clearance
+// field that lets lines and boxes skip the open space between tiles.
+class CCollision
+{
+    const CTileLayer *m_pLayer;
+    const CClearanceField *m_pClearance;
+
+public:
+    CCollision();
+
+    void Init(const CTileLayer *pLayer, const CClearanceField *pClearance = nullptr);
+
+    int Width() const { return m_pLayer ? m_pLayer->Width() : 0; }
+    int Height() const { return m_pLayer ? m_pLayer->Height() : 0; }
+    bool Loaded() const { return m_pLayer && m_pLayer->Loaded(); }
+    const CTileLayer& Layer() const { return *m_pLayer; }
+
+    ESMapItems GetTileAt(int TileX, int TileY) const;
+    ESMapItems GetTile(float X, float Y) const;
+
+    bool CheckPoint(float X, float Y, ESMapItems Flag = ESMapItems::TILEFLAG_SOLID) const { return m_pLayer->Check(round_to_int(X) / 32, round_to_int(Y) / 32, Flag); }
+    bool CheckPoint(vec2 Pos, ESMapItems Flag = ESMapItems::TILEFLAG_SOLID) const { return CheckPoint(Pos.x, Pos.y, Flag); }
+
+    bool IsGrounded(float X, float Y) const;
+    bool IsGrounded(vec2 Pos) const { return IsGrounded(Pos.x, Pos.y); }
+
+    ESMapItems IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const;
+
+    struct SLineHit
+    {
+        ESMapItems m_Tile;
+        vec2 m_Collision;
+        vec2 m_BeforeCollision;
+    };
+    // IntersectLine from pFrom[i] to pTo[i] into pHits[i]
+    void IntersectLines(const vec2 *pFrom, const vec2 *pTo, int Num, SLineHit *pHits) const;
+    bool TestBox(vec2 Pos, vec2 Size) const;
+    void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity) const;
+};
+
+#endif // TEEWORLDS_MAP_COLLISION_H
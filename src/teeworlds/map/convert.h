@@ -2,7 +2,9 @@
 #define TEEWORLDS_MAP_CONVERT_H
 
 #include <include/string.h>
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
 enum class ESMapItems : int32_t
 {
@@ -24,5 +26,13 @@ inline bool operator&(const ESMapItems& A, const ESMapItems& B)
 }
 
 bool ConvertMap(string Map, string Crc, ESMapItems **ppResult, int& Width, int& Height);
+// the same for a map file that is held in memory
+bool ConvertMapData(const void *pData, size_t Size, ESMapItems **ppResult, int& Width, int& Height);
+// ConvertMap through the <crc>.sgc grid cache next to the map. pCached tells
+// whether the cache was used. A caller that holds the map file, like after a
+// download, passes it in pMapData and the map is converted from there.
+bool LoadMapGrid(string Map, string Crc, ESMapItems **ppResult, int& Width, int& Height, bool *pCached = nullptr, const void *pMapData = nullptr, size_t MapSize = 0);
+// the <crc>.sgc for a grid LoadMapGrid converted, the caller stores it
+bool PackMapGrid(string Map, string Crc, const ESMapItems *pItems, int Width, int Height, std::vector<char>& vData);
 
 #endif // TEEWORLDS_MAP_CONVERT_H
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include <include/base.h>
+
+#include "datafile.h"
+
+#include <cstring>
+
+#include <zlib.h>
+
+struct CDatafileReader::SHeader
+{
+    char m_aID[4];
+    int m_Version;
+    int m_Size;
+    int m_Swaplen;
+    int m_NumItemTypes;
+    int m_NumItems;
+    int m_NumRawData;
+    int m_ItemSize;
+    int m_DataSize;
+};
+
+struct CDatafileReader::SItemType
+{
+    int m_Type;
+    int m_Start;
+    int m_Num;
+};
+
+struct CDatafileItem
+{
+    int m_TypeAndID;
+    int m_Size;
+};
+
+CDatafileReader::CDatafileReader()
+{
+    m_pHeader = nullptr;
+    m_pFile = nullptr;
+    m_FileSize = 0;
+}
+
+bool CDatafileReader::Open(const std::filesystem::path& Path)
+{
+    Close();
+    if(!m_File.Open(Path))
+        return false;
+    m_pFile = m_File.Data();
+    m_FileSize = m_File.Size();
+    if(!Parse())
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool CDatafileReader::Open(const void *pData, size_t Size)
+{
+    Close();
+    m_pFile = static_cast<const unsigned char *>(pData);
+    m_FileSize = Size;
+    if(!Parse())
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void CDatafileReader::Close()
+{
+    m_File.Close();
+    m_pHeader = nullptr;
+    m_pFile = nullptr;
+    m_FileSize = 0;
+}
+
+bool CDatafileReader::Parse()
+{
+    const unsigned char *pFile = m_pFile;
+    if(!pFile || m_FileSize < sizeof(SHeader))
+    {
+        log_msg("datafile", "file too short");
+        return false;
+    }
+
+    const SHeader *pHeader = reinterpret_cast<const SHeader *>(pFile);
+    if(memcmp(pHeader->m_aID, "ATAD", 4) != 0 && memcmp(pHeader->m_aID, "DATA", 4) != 0)
+    {
+        log_msgf("datafile", "wrong signature. {:c} {:c} {:c} {:c}", pHeader->m_aID[0], pHeader->m_aID[1], pHeader->m_aID[2], pHeader->m_aID[3]);
+        return false;
+    }
+    if(pHeader->m_Version != 3 && pHeader->m_Version != 4)
+    {
+        log_msgf("datafile", "wrong version. version={:d}", pHeader->m_Version);
+        return false;
+    }
+    if(pHeader->m_NumItemTypes < 0 || pHeader->m_NumItems < 0 || pHeader->m_NumRawData < 0 || pHeader->m_ItemSize < 0 || pHeader->m_DataSize < 0)
+    {
+        log_msg("datafile", "corrupt header");
+        return false;
+    }
+
+    // types, offsets, sizes and items follow the header, the data comes last
+    size_t Size = sizeof(SHeader);
+    Size += (size_t) pHeader->m_NumItemTypes * sizeof(SItemType);
+    Size += ((size_t) pHeader->m_NumItems + pHeader->m_NumRawData) * sizeof(int);
+    if(pHeader->m_Version == 4)
+        Size += (size_t) pHeader->m_NumRawData * sizeof(int); // v4 has uncompressed data sizes aswell
+    size_t ItemStart = Size;
+    Size += pHeader->m_ItemSize;
+    size_t DataStart = Size;
+    if(Size > m_FileSize)
+    {
+        log_msgf("datafile", "couldn't load the whole thing, wanted={} got={}", Size, m_FileSize);
+        return false;
+    }
+
+    m_pHeader = pHeader;
+    m_pItemTypes = reinterpret_cast<const SItemType *>(pFile + sizeof(SHeader));
+    m_pItemOffsets = reinterpret_cast<const int *>(m_pItemTypes + pHeader->m_NumItemTypes);
+    m_pDataOffsets = m_pItemOffsets + pHeader->m_NumItems;
+    m_pDataSizes = pHeader->m_Version == 4 ? m_pDataOffsets + pHeader->m_NumRawData : nullptr;
+    m_pItemStart = pFile + ItemStart;
+    m_pDataStart = pFile + DataStart;
+    return true;
+}
+
+void CDatafileReader::GetType(int Type, int *pStart, int *pNum) const
+{
+    *pStart = 0;
+    *pNum = 0;
+    if(!m_pHeader)
+        return;
+
+    for(int i = 0; i < m_pHeader->m_NumItemTypes; i++)
+    {
+        if(m_pItemTypes[i].m_Type == Type)
+        {
+            *pStart = m_pItemTypes[i].m_Start;
+            *pNum = m_pItemTypes[i].m_Num;
+            return;
+        }
+    }
+}
+
+const void *CDatafileReader::GetItem(int Index, int *pType, int *pID, int *pSize) const
+{
+    if(pType)
+        *pType = 0;
+    if(pID)
+        *pID = 0;
+    if(pSize)
+        *pSize = 0;
+    if(!m_pHeader || Index < 0 || Index >= m_pHeader->m_NumItems)
+        return nullptr;
+
+    int Offset = m_pItemOffsets[Index];
+    if(Offset < 0 || (size_t) Offset + sizeof(CDatafileItem) > (size_t) m_pHeader->m_ItemSize)
+        return nullptr;
+    const CDatafileItem *pItem = reinterpret_cast<const CDatafileItem *>(m_pItemStart + Offset);
+    if(pItem->m_Size < 0 || (size_t) Offset + sizeof(CDatafileItem) + pItem->m_Size > (size_t) m_pHeader->m_ItemSize)
+        return nullptr;
+
+    if(pType)
+        *pType = (pItem->m_TypeAndID >> 16) & 0xffff; // remove sign extention
+    if(pID)
+        *pID = pItem->m_TypeAndID & 0xffff;
+    if(pSize)
+        *pSize = pItem->m_Size;
+    return pItem + 1;
+}
+
+int CDatafileReader::NumData() const
+{
+    return m_pHeader ? m_pHeader->m_NumRawData : 0;
+}
+
+int CDatafileReader::GetFileDataSize(int Index) const
+{
+    // a cut off download still has the blobs in front of the cut
+    int End = Index == m_pHeader->m_NumRawData - 1 ? m_pHeader->m_DataSize : m_pDataOffsets[Index + 1];
+    int Start = m_pDataOffsets[Index];
+    if(Start < 0 || End < Start || (size_t) End > m_FileSize - (m_pDataStart - m_pFile))
+        return -1;
+    return End - Start;
+}
+
+int CDatafileReader::GetDataSize(int Index) const
+{
+    if(Index < 0 || Index >= NumData())
+        return -1;
+    return m_pDataSizes ? m_pDataSizes[Index] : GetFileDataSize(Index);
+}
+
+bool CDatafileReader::ReadDataChunks(int Index, FChunk pfnChunk, void *pUser) const
+{
+    if(Index < 0 || Index >= NumData())
+        return false;
+    int FileSize = GetFileDataSize(Index);
+    if(FileSize < 0)
+        return false;
+    const unsigned char *pData = m_pDataStart + m_pDataOffsets[Index];
+
+    // v3 stores the data as is
+    if(!m_pDataSizes)
+        return pfnChunk(pUser, pData, FileSize);
+
+    // v4 has compressed data, inflate it through a small buffer
+    z_stream Stream = {};
+    Stream.next_in = const_cast<Bytef *>(pData);
+    Stream.avail_in = FileSize;
+    if(inflateInit(&Stream) != Z_OK)
+        return false;
+
+    unsigned char aBuffer[16 * 1024];
+    size_t Total = 0;
+    int Result = Z_OK;
+    while(Result == Z_OK)
+    {
+        Stream.next_out = aBuffer;
+        Stream.avail_out = sizeof(aBuffer);
+        Result = inflate(&Stream, Z_NO_FLUSH);
+        size_t Produced = sizeof(aBuffer) - Stream.avail_out;
+        if(Result != Z_OK && Result != Z_STREAM_END)
+            break;
+        Total += Produced;
+        if(Total > (size_t) m_pDataSizes[Index] || (Produced && !pfnChunk(pUser, aBuffer, Produced)))
+        {
+            Result = Z_DATA_ERROR;
+            break;
+        }
+    }
+    inflateEnd(&Stream);
+
+    if(Result != Z_STREAM_END || Total != (size_t) m_pDataSizes[Index])
+    {
+        log_msgf("datafile", "couldn't uncompress data {}, zlib={} size={} wanted={}", Index, Result, Total, m_pDataSizes[Index]);
+        return false;
+    }
+    return true;
+}
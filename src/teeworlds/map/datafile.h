@@ -0,0 +1,69 @@
+#ifndef TEEWORLDS_MAP_DATAFILE_H
+#define TEEWORLDS_MAP_DATAFILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <type_traits>
+
+#include "mappedfile.h"
+
+// Read-only view of a teeworlds datafile. The file is mapped into memory and
+// items and raw data are pointers into the mapping, so opening a map reads
+// nothing but the pages that are actually looked at. A map that was just
+// downloaded is read from memory the same way.
+class CDatafileReader
+{
+public:
+    CDatafileReader();
+
+    bool Open(const std::filesystem::path& Path);
+    // a datafile that is already in memory and outlives the reader
+    bool Open(const void *pData, size_t Size);
+    void Close();
+    bool IsOpen() const { return m_pHeader != nullptr; }
+
+    void GetType(int Type, int *pStart, int *pNum) const;
+    // nullptr if Index is out of range
+    const void *GetItem(int Index, int *pType, int *pID, int *pSize = nullptr) const;
+
+    int NumData() const;
+    // size of the data once uncompressed
+    int GetDataSize(int Index) const;
+    // Calls Consume(const void *pData, size_t Size) with the uncompressed data
+    // in order, a chunk at a time, without holding all of it in memory.
+    template<typename FConsume>
+    bool ReadData(int Index, FConsume&& Consume) const;
+
+private:
+    struct SHeader;
+    struct SItemType;
+
+    CMappedFile m_File;
+    const unsigned char *m_pFile; // the mapping or the caller's memory
+    size_t m_FileSize;
+
+    const SHeader *m_pHeader;
+    const SItemType *m_pItemTypes;
+    const int *m_pItemOffsets;
+    const int *m_pDataOffsets;
+    const int *m_pDataSizes; // v4 only
+    const unsigned char *m_pItemStart;
+    const unsigned char *m_pDataStart;
+
+    bool Parse();
+    int GetFileDataSize(int Index) const;
+    typedef bool (*FChunk)(void *pUser, const void *pData, size_t Size);
+    bool ReadDataChunks(int Index, FChunk pfnChunk, void *pUser) const;
+};
+
+template<typename FConsume>
+bool CDatafileReader::ReadData(int Index, FConsume&& Consume) const
+{
+    return ReadDataChunks(Index, [](void *pUser, const void *pData, size_t Size) -> bool
+    {
+        return (*static_cast<std::remove_reference_t<FConsume> *>(pUser))(pData, Size);
+    }, (void *) std::addressof(Consume));
+}
+
+#endif // TEEWORLDS_MAP_DATAFILE_H
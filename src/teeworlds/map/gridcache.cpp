@@ -0,0 +1,84 @@
+#include <include/base.h>
+
+#include "gridcache.h"
+#include "mappedfile.h"
+
+#include <cstring>
+#include <vector>
+
+static const char s_aGridCacheMagic[4] = {'S', 'G', 'C', 'M'};
+// bump when ConvertMap starts to translate tiles differently
+static const int s_GridCacheVersion = 1;
+
+struct SGridCacheHeader
+{
+    char m_aMagic[4];
+    int32_t m_Version;
+    int32_t m_Width;
+    int32_t m_Height;
+    uint64_t m_MapSize;
+    int64_t m_MapTime;
+};
+
+static bool MapStamp(const std::filesystem::path& MapPath, uint64_t& Size, int64_t& Time)
+{
+    std::error_code Error;
+    Size = std::filesystem::file_size(MapPath, Error);
+    if(Error)
+        return false;
+    Time = std::filesystem::last_write_time(MapPath, Error).time_since_epoch().count();
+    return !Error;
+}
+
+bool ReadGridCache(const std::filesystem::path& CachePath, const std::filesystem::path& MapPath, ESMapItems **ppResult, int& Width, int& Height)
+{
+    uint64_t MapSize;
+    int64_t MapTime;
+    if(!MapStamp(MapPath, MapSize, MapTime))
+        return false;
+
+    CMappedFile File;
+    if(!File.Open(CachePath))
+        return false;
+
+    SGridCacheHeader Header;
+    if(File.Size() < sizeof(Header))
+        return false;
+    memcpy(&Header, File.Data(), sizeof(Header));
+    if(memcmp(Header.m_aMagic, s_aGridCacheMagic, sizeof(Header.m_aMagic)) || Header.m_Version != s_GridCacheVersion ||
+        Header.m_MapSize != MapSize || Header.m_MapTime != MapTime || Header.m_Width <= 0 || Header.m_Height <= 0)
+        return false;
+
+    size_t Tiles = (size_t) Header.m_Width * Header.m_Height;
+    if(File.Size() != sizeof(Header) + (Tiles + 1) / 2)
+        return false;
+
+    const unsigned char *pPacked = File.Data() + sizeof(Header);
+    ESMapItems *pItems = new ESMapItems[Tiles];
+    for(size_t i = 0; i < Tiles; i++)
+        pItems[i] = static_cast<ESMapItems>(pPacked[i / 2] >> (i % 2 * 4) & 15);
+
+    Width = Header.m_Width;
+    Height = Header.m_Height;
+    *ppResult = pItems;
+    return true;
+}
+
+bool PackGridCache(const std::filesystem::path& MapPath, const ESMapItems *pItems, int Width, int Height, std::vector<char>& vData)
+{
+    SGridCacheHeader Header;
+    memcpy(Header.m_aMagic, s_aGridCacheMagic, sizeof(Header.m_aMagic));
+    Header.m_Version = s_GridCacheVersion;
+    Header.m_Width = Width;
+    Header.m_Height = Height;
+    if(!MapStamp(MapPath, Header.m_MapSize, Header.m_MapTime))
+        return false;
+
+    size_t Tiles = (size_t) Width * Height;
+    vData.assign(sizeof(Header) + (Tiles + 1) / 2, 0);
+    memcpy(vData.data(), &Header, sizeof(Header));
+    unsigned char *pPacked = (unsigned char *) vData.data() + sizeof(Header);
+    for(size_t i = 0; i < Tiles; i++)
+        pPacked[i / 2] |= (static_cast<int32_t>(pItems[i]) & 15) << (i % 2 * 4);
+    return true;
+}
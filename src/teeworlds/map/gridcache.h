@@ -0,0 +1,16 @@
+#ifndef TEEWORLDS_MAP_GRIDCACHE_H
+#define TEEWORLDS_MAP_GRIDCACHE_H
+
+#include <filesystem>
+#include <vector>
+
+#include "convert.h"
+
+// The converted game layer of a map, stored next to it as <crc>.sgc with four
+// bits per tile. The cache remembers the size and time of the .map it was made
+// from and is ignored once the map changes.
+bool ReadGridCache(const std::filesystem::path& CachePath, const std::filesystem::path& MapPath, ESMapItems **ppResult, int& Width, int& Height);
+// the contents of the cache, written by the storage
+bool PackGridCache(const std::filesystem::path& MapPath, const ESMapItems *pItems, int Width, int Height, std::vector<char>& vData);
+
+#endif // TEEWORLDS_MAP_GRIDCACHE_H
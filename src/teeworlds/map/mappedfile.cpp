@@ -0,0 +1,87 @@
+#include <include/base.h>
+
+#include <teeworlds/six/detect.h>
+
+#include "mappedfile.h"
+
+#if defined(CONF_FAMILY_WINDOWS)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::CMappedFile() :
+    m_pData(nullptr), m_Size(0), m_pMapping(nullptr)
+{
+}
+
+CMappedFile::~CMappedFile()
+{
+    Close();
+}
+
+bool CMappedFile::Open(const std::filesystem::path& Path)
+{
+    Close();
+
+#if defined(CONF_FAMILY_WINDOWS)
+    HANDLE File = CreateFileW(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(File == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER Size;
+    if(!GetFileSizeEx(File, &Size) || Size.QuadPart <= 0)
+    {
+        CloseHandle(File);
+        return false;
+    }
+    HANDLE Mapping = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(File);
+    if(!Mapping)
+        return false;
+    void *pView = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!pView)
+    {
+        CloseHandle(Mapping);
+        return false;
+    }
+    m_pMapping = Mapping;
+    m_pData = static_cast<const unsigned char *>(pView);
+    m_Size = Size.QuadPart;
+#else
+    int File = open(Path.c_str(), O_RDONLY);
+    if(File < 0)
+        return false;
+    struct stat Stat;
+    if(fstat(File, &Stat) != 0 || Stat.st_size <= 0)
+    {
+        close(File);
+        return false;
+    }
+    void *pView = mmap(nullptr, Stat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+    close(File); // the mapping keeps the file alive
+    if(pView == MAP_FAILED)
+        return false;
+    m_pData = static_cast<const unsigned char *>(pView);
+    m_Size = Stat.st_size;
+#endif
+    return true;
+}
+
+void CMappedFile::Close()
+{
+    if(m_pData)
+    {
+#if defined(CONF_FAMILY_WINDOWS)
+        UnmapViewOfFile(m_pData);
+        CloseHandle(m_pMapping);
+#else
+        munmap((void *) m_pData, m_Size);
+#endif
+    }
+    m_pData = nullptr;
+    m_Size = 0;
+    m_pMapping = nullptr;
+}
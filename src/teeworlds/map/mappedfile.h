@@ -0,0 +1,32 @@
+#ifndef TEEWORLDS_MAP_MAPPEDFILE_H
+#define TEEWORLDS_MAP_MAPPEDFILE_H
+
+#include <cstddef>
+#include <filesystem>
+
+// A whole file mapped read-only into memory, unmapped on Close or when the
+// object goes away.
+class CMappedFile
+{
+public:
+    CMappedFile();
+    ~CMappedFile();
+
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+
+    // fails on missing and empty files
+    bool Open(const std::filesystem::path& Path);
+    void Close();
+
+    bool IsOpen() const { return m_pData != nullptr; }
+    const unsigned char *Data() const { return m_pData; }
+    size_t Size() const { return m_Size; }
+
+private:
+    const unsigned char *m_pData;
+    size_t m_Size;
+    void *m_pMapping; // the mapping handle where the platform has one
+};
+
+#endif // TEEWORLDS_MAP_MAPPEDFILE_H
@@ -0,0 +1,39 @@
+#include <include/base.h>
+
+#include "overlay.h"
+
+#include <algorithm>
+#include <iterator>
+
+void CDangerOverlay::Init(int Width, int Height)
+{
+    m_Width = std::max(Width, 0);
+    m_Height = std::max(Height, 0);
+    m_vBits.assign(((size_t) m_Width * m_Height + 63) / 64, 0);
+    m_vCells.clear();
+    m_Generation++;
+}
+
+void CDangerOverlay::Clear()
+{
+    if(m_vCells.empty())
+        return;
+    for(int Cell : m_vCells)
+        Flip(Cell);
+    m_vCells.clear();
+    m_Generation++;
+}
+
+bool CDangerOverlay::Assign(const std::vector<int>& vCells, std::vector<int>& vChanged)
+{
+    if(vCells == m_vCells)
+        return false;
+
+    size_t First = vChanged.size();
+    std::set_symmetric_difference(m_vCells.begin(), m_vCells.end(), vCells.begin(), vCells.end(), std::back_inserter(vChanged));
+    for(size_t i = First; i < vChanged.size(); i++)
+        Flip(vChanged[i]);
+    m_vCells = vCells;
+    m_Generation++;
+    return true;
+}
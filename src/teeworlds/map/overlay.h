@@ -0,0 +1,71 @@
+#ifndef TEEWORLDS_MAP_OVERLAY_H
+#define TEEWORLDS_MAP_OVERLAY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "convert.h"
+#include "tilelayer.h"
+
+// Tiles marked dangerous on top of the static map, the lasers of a tick.
+// A bit per tile answers lookups and the sorted list of marked tiles is what
+// the distance fields are built from, so clearing touches only the tiles
+// that were marked. The generation changes whenever the marked set does.
+class CDangerOverlay
+{
+public:
+    CDangerOverlay() :
+        m_Width(0), m_Height(0), m_Generation(0) {}
+
+    // an empty overlay for a map of this size
+    void Init(int Width, int Height);
+    void Clear();
+
+    // Marks exactly vCells, sorted and unique, and appends the tiles that
+    // changed to vChanged. False if the marked set stayed the same.
+    bool Assign(const std::vector<int>& vCells, std::vector<int>& vChanged);
+
+    bool Test(int Cell) const { return (unsigned) Cell < (unsigned) (m_Width * m_Height) && (m_vBits[Cell >> 6] >> (Cell & 63) & 1); }
+    bool Test(int X, int Y) const { return X >= 0 && X < m_Width && Y >= 0 && Y < m_Height && Test(Y * m_Width + X); }
+
+    bool Empty() const { return m_vCells.empty(); }
+    const std::vector<int>& Cells() const { return m_vCells; }
+    uint64_t Generation() const { return m_Generation; }
+
+private:
+    int m_Width;
+    int m_Height;
+    uint64_t m_Generation;
+    std::vector<uint64_t> m_vBits;
+    std::vector<int> m_vCells;
+
+    void Flip(int Cell)
+    {
+        if((unsigned) Cell < (unsigned) (m_Width * m_Height))
+            m_vBits[Cell >> 6] ^= 1ULL << (Cell & 63);
+    }
+};
+
+// The tile layer read through a danger overlay, marked tiles count as death
+// tiles. Nothing is merged, every lookup asks both layers.
+class CLayeredGrid
+{
+public:
+    CLayeredGrid(const CTileLayer& Layer, const CDangerOverlay& Overlay) :
+        m_pLayer(&Layer), m_pOverlay(&Overlay) {}
+
+    // the values of CTileLayer::GridValue
+    int GridValue(int X, int Y) const { return m_pOverlay->Test(X, Y) ? -1 : m_pLayer->GridValue(X, Y); }
+    bool Check(int X, int Y, ESMapItems Flag) const
+    {
+        if((Flag & ESMapItems::TILEFLAG_DEATH) && m_pOverlay->Test(X, Y))
+            return true;
+        return m_pLayer->Check(X, Y, Flag);
+    }
+
+private:
+    const CTileLayer *m_pLayer;
+    const CDangerOverlay *m_pOverlay;
+};
+
+#endif // TEEWORLDS_MAP_OVERLAY_H
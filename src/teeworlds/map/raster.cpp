@@ -0,0 +1,84 @@
+#include <include/base.h>
+
+#include "raster.h"
+
+#include <algorithm>
+#include <cmath>
+
+void RasterizeSegment(vec2 From, vec2 To, int Width, int Height, int Margin, std::vector<int>& vCells)
+{
+    if(Width <= 0 || Height <= 0 || !std::isfinite(From.x) || !std::isfinite(From.y) || !std::isfinite(To.x) || !std::isfinite(To.y))
+        return;
+
+    // tiles X0..X1 of rows Y0..Y1 that lie on the map
+    auto AddSpan = [&](int X0, int Y0, int X1, int Y1)
+    {
+        X0 = std::max(X0, 0);
+        Y0 = std::max(Y0, 0);
+        X1 = std::min(X1, Width - 1);
+        Y1 = std::min(Y1, Height - 1);
+        for(int y = Y0; y <= Y1; y++)
+            for(int x = X0; x <= X1; x++)
+                vCells.push_back(y * Width + x);
+    };
+
+    // a laser reaching far off the map is cut to the tiles around it first
+    double X0 = From.x / 32.0, Y0 = From.y / 32.0;
+    double DX = To.x / 32.0 - X0, DY = To.y / 32.0 - Y0;
+    double Enter = 0, Leave = 1;
+    auto Clip = [&](double Start, double Delta, double Low, double High)
+    {
+        if(Delta == 0)
+        {
+            if(Start < Low || Start > High)
+                Enter = INFINITY;
+            return;
+        }
+        double t0 = (Low - Start) / Delta, t1 = (High - Start) / Delta;
+        Enter = std::max(Enter, std::min(t0, t1));
+        Leave = std::min(Leave, std::max(t0, t1));
+    };
+    Clip(X0, DX, -Margin - 1, Width + Margin + 1);
+    Clip(Y0, DY, -Margin - 1, Height + Margin + 1);
+    if(Enter > Leave)
+        return;
+
+    int TileX = (int) std::floor(X0 + DX * Enter), TileY = (int) std::floor(Y0 + DY * Enter);
+    int EndX = (int) std::floor(X0 + DX * Leave), EndY = (int) std::floor(Y0 + DY * Leave);
+    int StepX = DX > 0 ? 1 : -1, StepY = DY > 0 ? 1 : -1;
+    double DeltaX = DX != 0 ? 1 / std::abs(DX) : INFINITY;
+    double DeltaY = DY != 0 ? 1 / std::abs(DY) : INFINITY;
+    double NextX = DX != 0 ? (TileX + (DX > 0) - X0) / DX : INFINITY;
+    double NextY = DY != 0 ? (TileY + (DY > 0) - Y0) / DY : INFINITY;
+
+    // Every step moves the square of the margin by one tile, so only its
+    // leading edge is new.
+    AddSpan(TileX - Margin, TileY - Margin, TileX + Margin, TileY + Margin);
+    for(int Steps = std::abs(EndX - TileX) + std::abs(EndY - TileY); Steps > 0; Steps--)
+    {
+        if(NextX < NextY)
+        {
+            TileX += StepX;
+            NextX += DeltaX;
+            AddSpan(TileX + StepX * Margin, TileY - Margin, TileX + StepX * Margin, TileY + Margin);
+        }
+        else if(NextY < NextX)
+        {
+            TileY += StepY;
+            NextY += DeltaY;
+            AddSpan(TileX - Margin, TileY + StepY * Margin, TileX + Margin, TileY + StepY * Margin);
+        }
+        else
+        {
+            // through a corner, the tiles on both sides of it count
+            AddSpan(TileX + StepX - Margin, TileY - Margin, TileX + StepX + Margin, TileY + Margin);
+            AddSpan(TileX - Margin, TileY + StepY - Margin, TileX + Margin, TileY + StepY + Margin);
+            TileX += StepX;
+            TileY += StepY;
+            NextX += DeltaX;
+            NextY += DeltaY;
+            AddSpan(TileX - Margin, TileY - Margin, TileX + Margin, TileY + Margin);
+            Steps--;
+        }
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef TEEWORLDS_MAP_RASTER_H
+#define TEEWORLDS_MAP_RASTER_H
+
+#include <vector>
+
+#include <teeworlds/six/vmath.h>
+
+// Appends Y * Width + X for every tile the segment From..To passes through,
+// in pixels, both tiles beside a corner it crosses included (supercover).
+// Margin widens it by that many tiles each way. Tiles off the map are left
+// out, a tile may be appended more than once.
+void RasterizeSegment(vec2 From, vec2 To, int Width, int Height, int Margin, std::vector<int>& vCells);
+
+#endif // TEEWORLDS_MAP_RASTER_H
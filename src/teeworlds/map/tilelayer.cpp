@@ -0,0 +1,158 @@
+#include <include/base.h>
+
+#include "tilelayer.h"
+
+#include <algorithm>
+#include <cstring>
+
+void CTileLayer::Init(const ESMapItems *pTiles, int Width, int Height)
+{
+    Clear();
+    if(!pTiles || Width <= 0 || Height <= 0)
+        return;
+
+    m_Width = Width;
+    m_Height = Height;
+    m_Words = (Width + 63) / 64;
+    m_Stride = (m_Words + 2 + 7) & ~7; // whole cache lines
+    m_vBits.assign((size_t) (Height + 2 * BORDER) * NUM_PLANES * m_Stride, 0);
+
+    for(int y = 0; y < Height; y++)
+    {
+        const ESMapItems *pRow = pTiles + (size_t) y * Width;
+        for(int Plane = 0; Plane < NUM_PLANES; Plane++)
+        {
+            uint64_t *pBits = Row(y, Plane);
+            for(int x = 0; x < Width; x++)
+                pBits[x >> 6] |= (uint64_t) (static_cast<int32_t>(pRow[x]) >> Plane & 1) << (x & 63);
+
+            // the border repeats the first and last column
+            if(pBits[0] & 1)
+                pBits[-1] = ~0ULL;
+            if(pBits[(Width - 1) >> 6] >> ((Width - 1) & 63) & 1)
+            {
+                pBits[(Width - 1) >> 6] |= ~LastMask(Width - 1);
+                for(int w = ((Width - 1) >> 6) + 1; w < m_Stride - 1; w++)
+                    pBits[w] = ~0ULL;
+            }
+        }
+    }
+
+    // ...and the first and last row
+    size_t RowWords = (size_t) NUM_PLANES * m_Stride;
+    for(int y = -BORDER; y < 0; y++)
+        memcpy(Row(y, 0) - 1, Row(0, 0) - 1, RowWords * sizeof(uint64_t));
+    for(int y = Height; y < Height + BORDER; y++)
+        memcpy(Row(y, 0) - 1, Row(Height - 1, 0) - 1, RowWords * sizeof(uint64_t));
+}
+
+void CTileLayer::Clear()
+{
+    m_Width = 0;
+    m_Height = 0;
+    m_Words = 0;
+    m_Stride = 0;
+    m_vBits.clear();
+    m_vBits.shrink_to_fit();
+}
+
+bool CTileLayer::LongRowSpan(int Y, int X0, int X1, int Flags) const
+{
+    int First = X0 >> 6;
+    int Last = X1 >> 6;
+    if(RowBits(Y, First, Flags) & FirstMask(X0))
+        return true;
+    for(int w = First + 1; w < Last; w++)
+        if(RowBits(Y, w, Flags))
+            return true;
+    return RowBits(Y, Last, Flags) & LastMask(X1);
+}
+
+bool CTileLayer::LongBox(int X0, int Y0, int X1, int Y1, int Flags) const
+{
+    // rows past the border all equal its last row
+    Y0 = std::clamp(Y0, -BORDER, m_Height + BORDER - 1);
+    Y1 = std::clamp(Y1, -BORDER, m_Height + BORDER - 1);
+    for(int y = Y0; y <= Y1; y++)
+        if(RowSpan(y, X0, X1, static_cast<ESMapItems>(Flags)))
+            return true;
+    return false;
+}
+
+bool CTileLayer::RowScan(int Y, int X0, int X1, ESMapItems Flag, int *pHitX) const
+{
+    // beyond the border every tile equals the outermost one
+    int Start = X0;
+    int End = X1;
+    ClampToBorder(Start, Y);
+    ClampToBorder(End, Y);
+    int Flags = static_cast<int32_t>(Flag);
+    if(Start != X0 && RowBits(Y, Start >> 6, Flags) >> (Start & 63) & 1)
+    {
+        *pHitX = X0;
+        return true;
+    }
+
+    if(Start <= End)
+    {
+        for(int w = Start >> 6; w <= End >> 6; w++)
+        {
+            uint64_t Bits = RowBits(Y, w, Flags);
+            if(w == Start >> 6)
+                Bits &= FirstMask(Start);
+            if(w == End >> 6)
+                Bits &= LastMask(End);
+            if(Bits)
+            {
+                *pHitX = w * 64 + __builtin_ctzll(Bits);
+                return true;
+            }
+        }
+    }
+    else
+    {
+        for(int w = Start >> 6; w >= End >> 6; w--)
+        {
+            uint64_t Bits = RowBits(Y, w, Flags);
+            if(w == Start >> 6)
+                Bits &= LastMask(Start);
+            if(w == End >> 6)
+                Bits &= FirstMask(End);
+            if(Bits)
+            {
+                *pHitX = w * 64 + 63 - __builtin_clzll(Bits);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CTileLayer::ColumnScan(int X, int Y0, int Y1, ESMapItems Flag, int *pHitY) const
+{
+    int Start = Y0;
+    int End = Y1;
+    ClampToBorder(X, Start);
+    ClampToBorder(X, End);
+    int Flags = static_cast<int32_t>(Flag);
+    int Word = X >> 6;
+    int Bit = X & 63;
+    if(Start != Y0 && RowBits(Start, Word, Flags) >> Bit & 1)
+    {
+        *pHitY = Y0;
+        return true;
+    }
+
+    int Step = Start <= End ? 1 : -1;
+    for(int y = Start;; y += Step)
+    {
+        if(RowBits(y, Word, Flags) >> Bit & 1)
+        {
+            *pHitY = y;
+            return true;
+        }
+        if(y == End)
+            break;
+    }
+    return false;
+}
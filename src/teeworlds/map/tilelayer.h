@@ -0,0 +1,167 @@
+#ifndef TEEWORLDS_MAP_TILELAYER_H
+#define TEEWORLDS_MAP_TILELAYER_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "convert.h"
+
+// Allocates on cache line boundaries, so every row of a CTileLayer starts
+// on one.
+template<typename T>
+struct SCacheLineAllocator
+{
+    typedef T value_type;
+    static constexpr std::align_val_t ALIGNMENT{64};
+
+    SCacheLineAllocator() = default;
+    template<typename U>
+    SCacheLineAllocator(const SCacheLineAllocator<U>&) {}
+
+    T *allocate(size_t Count) { return static_cast<T *>(::operator new(Count * sizeof(T), ALIGNMENT)); }
+    void deallocate(T *p, size_t) { ::operator delete(p, ALIGNMENT); }
+
+    template<typename U>
+    bool operator==(const SCacheLineAllocator<U>&) const { return true; }
+};
+
+// The game layer as one bit plane per tile flag, four bits per tile. Rows are
+// padded to whole cache lines and the planes of a row lie next to each other.
+// A border of BORDER tiles around the map repeats the edge tiles, which is
+// what clamping the coordinates used to give, so lookups near the map only
+// clamp once they leave the border.
+class CTileLayer
+{
+public:
+    enum
+    {
+        PLANE_SOLID = 0,
+        PLANE_DEATH,
+        PLANE_UNHOOKABLE,
+        PLANE_INFECTION,
+        NUM_PLANES,
+    };
+
+    static constexpr int BORDER = 64; // one word on each side of a row
+
+    CTileLayer() :
+        m_Width(0), m_Height(0), m_Words(0), m_Stride(0) {}
+
+    void Init(const ESMapItems *pTiles, int Width, int Height);
+    void Clear();
+
+    bool Loaded() const { return m_Width > 0; }
+    int Width() const { return m_Width; }
+    int Height() const { return m_Height; }
+    size_t MemoryUsage() const { return m_vBits.size() * sizeof(uint64_t); }
+
+    ESMapItems GetTile(int X, int Y) const
+    {
+        ClampToBorder(X, Y);
+        int Tile = 0;
+        for(int Plane = 0; Plane < NUM_PLANES; Plane++)
+            Tile |= (Row(Y, Plane)[X >> 6] >> (X & 63) & 1) << Plane;
+        return static_cast<ESMapItems>(Tile);
+    }
+
+    bool Check(int X, int Y, ESMapItems Flag) const
+    {
+        ClampToBorder(X, Y);
+        return RowBits(Y, X >> 6, static_cast<int32_t>(Flag)) >> (X & 63) & 1;
+    }
+
+    // 1 for solid, -1 for death and 0 for anything else, the values of the
+    // grids the path layers are built from
+    int GridValue(int X, int Y) const
+    {
+        if(Check(X, Y, ESMapItems::TILEFLAG_DEATH))
+            return -1;
+        return Check(X, Y, ESMapItems::TILEFLAG_SOLID) ? 1 : 0;
+    }
+
+    // whether any tile of columns X0..X1 in row Y has one of the flags
+    bool RowSpan(int Y, int X0, int X1, ESMapItems Flag) const
+    {
+        if(X0 > X1)
+            std::swap(X0, X1);
+        ClampToBorder(X0, Y);
+        ClampToBorder(X1, Y);
+        int Flags = static_cast<int32_t>(Flag);
+        int First = X0 >> 6;
+        int Last = X1 >> 6;
+        if(First == Last)
+            return RowBits(Y, First, Flags) & FirstMask(X0) & LastMask(X1);
+        if(First + 1 == Last)
+            return (RowBits(Y, First, Flags) & FirstMask(X0)) | (RowBits(Y, Last, Flags) & LastMask(X1));
+        return LongRowSpan(Y, X0, X1, Flags);
+    }
+    // the same over rows Y0..Y1
+    bool Box(int X0, int Y0, int X1, int Y1, ESMapItems Flag) const
+    {
+        if(X0 > X1)
+            std::swap(X0, X1);
+        if(Y0 > Y1)
+            std::swap(Y0, Y1);
+        if(X1 - X0 >= 64 || Y1 - Y0 > 1)
+            return LongBox(X0, Y0, X1, Y1, static_cast<int32_t>(Flag));
+
+        // at most two rows and two words, masked without branches
+        ClampToBorder(X0, Y0);
+        ClampToBorder(X1, Y1);
+        int Flags = static_cast<int32_t>(Flag);
+        int First = X0 >> 6;
+        int Last = X1 >> 6;
+        uint64_t FirstWordMask = FirstMask(X0) & (First == Last ? LastMask(X1) : ~0ULL);
+        uint64_t LastWordMask = First == Last ? 0 : LastMask(X1);
+        if((RowBits(Y0, First, Flags) & FirstWordMask) | (RowBits(Y0, Last, Flags) & LastWordMask))
+            return true;
+        return (RowBits(Y1, First, Flags) & FirstWordMask) | (RowBits(Y1, Last, Flags) & LastWordMask);
+    }
+    // First tile with one of the flags from X0 towards X1, or from Y0 towards
+    // Y1 for a column. Either end may be the larger one.
+    bool RowScan(int Y, int X0, int X1, ESMapItems Flag, int *pHitX) const;
+    bool ColumnScan(int X, int Y0, int Y1, ESMapItems Flag, int *pHitY) const;
+
+    // Columns 0..63 of the row are word 0. Rows from -BORDER to
+    // Height() + BORDER - 1 and words -1 to Words() are valid.
+    const uint64_t *Row(int Y, int Plane) const { return m_vBits.data() + ((size_t) (Y + BORDER) * NUM_PLANES + Plane) * m_Stride + 1; }
+    int Words() const { return m_Words; }
+
+private:
+    int m_Width;
+    int m_Height;
+    int m_Words; // words covering the width of the map
+    int m_Stride; // words per plane row
+    std::vector<uint64_t, SCacheLineAllocator<uint64_t>> m_vBits;
+
+    static uint64_t FirstMask(int X) { return ~0ULL << (X & 63); }
+    static uint64_t LastMask(int X) { return ~0ULL >> (63 - (X & 63)); }
+
+    bool LongRowSpan(int Y, int X0, int X1, int Flags) const;
+    bool LongBox(int X0, int Y0, int X1, int Y1, int Flags) const;
+
+    uint64_t *Row(int Y, int Plane) { return m_vBits.data() + ((size_t) (Y + BORDER) * NUM_PLANES + Plane) * m_Stride + 1; }
+
+    void ClampToBorder(int& X, int& Y) const
+    {
+        if((unsigned) (X + BORDER) >= (unsigned) (m_Width + 2 * BORDER))
+            X = X < 0 ? -BORDER : m_Width + BORDER - 1;
+        if((unsigned) (Y + BORDER) >= (unsigned) (m_Height + 2 * BORDER))
+            Y = Y < 0 ? -BORDER : m_Height + BORDER - 1;
+    }
+
+    // one word of a row, the planes of Flags ORed together
+    uint64_t RowBits(int Y, int Word, int Flags) const
+    {
+        const uint64_t *pWord = Row(Y, 0) + Word;
+        uint64_t Bits = 0;
+        for(; Flags; Flags &= Flags - 1)
+            Bits |= pWord[(size_t) __builtin_ctz(Flags) * m_Stride];
+        return Bits;
+    }
+};
+
+#endif // TEEWORLDS_MAP_TILELAYER_H
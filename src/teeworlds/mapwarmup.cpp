@@ -0,0 +1,178 @@
+#include <include/base.h>
+
+#include <base/storage.h>
+#include <teeworlds/map/convert.h>
+
+#include "mapwarmup.h"
+
+#include <algorithm>
+#include <chrono>
+
+static long long Microseconds(std::chrono::steady_clock::time_point Start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Start).count();
+}
+
+bool PrepareMap(IStorage *pStorage, const char *pMap, const char *pCrc, const void *pData, int Size, const CTuningParams *pNavTuning, bool Landmarks, SPreparedMap& Prepared)
+{
+    Prepared.m_Map = pMap;
+    Prepared.m_Crc = pCrc;
+
+    auto LoadStart = std::chrono::steady_clock::now();
+    bool GridCached;
+    ESMapItems *pTiles = nullptr;
+    int Width, Height;
+    if(!LoadMapGrid(pMap, pCrc, &pTiles, Width, Height, &GridCached, pData, Size))
+        return false;
+    std::vector<char> vGridCache;
+    if(!GridCached && (!PackMapGrid(pMap, pCrc, pTiles, Width, Height, vGridCache) || !pStorage->TwsWriteMapData(pMap, pCrc, "sgc", vGridCache.data(), vGridCache.size())))
+        log_msg("sugarcane/tws", "failed to save the map grid");
+    Prepared.m_TileLayer.Init(pTiles, Width, Height);
+    delete[] pTiles;
+    log_msgf("sugarcane/tws", "map grid: {}x{}, {} in {} us, {} KiB", Width, Height, GridCached ? "cached" : "converted", Microseconds(LoadStart), Prepared.m_TileLayer.MemoryUsage() / 1024);
+    auto ClearanceStart = std::chrono::steady_clock::now();
+    Prepared.m_Clearance.Build(Prepared.m_TileLayer);
+    log_msgf("sugarcane/tws", "clearance field: {} us, {} KiB", Microseconds(ClearanceStart), Prepared.m_Clearance.MemoryUsage() / 1024);
+
+    Prepared.m_PathGrid.Build(Prepared.m_TileLayer);
+    Prepared.m_PathHierarchy.Build(Prepared.m_PathGrid);
+
+    Prepared.m_HasLandmarks = Landmarks;
+    if(Landmarks)
+    {
+        IFileView *pTables = pStorage->TwsViewMapData(pMap, pCrc, "alt");
+        bool Loaded = pTables && Prepared.m_Landmarks.Load(pTables->Data(), Prepared.m_PathGrid);
+        if(pTables)
+            pTables->Close();
+        if(Loaded)
+            log_msgf("sugarcane/tws", "landmark tables: {} landmarks loaded", Prepared.m_Landmarks.NumLandmarks());
+        else
+        {
+            auto BuildStart = std::chrono::steady_clock::now();
+            Prepared.m_Landmarks.Build(Prepared.m_PathGrid);
+            std::vector<char> vData;
+            Prepared.m_Landmarks.Save(vData);
+            if(!pStorage->TwsWriteMapData(pMap, pCrc, "alt", vData.data(), vData.size()))
+                log_msg("sugarcane/tws", "failed to save landmark tables");
+            log_msgf("sugarcane/tws", "landmark tables: {} landmarks, built in {} ms", Prepared.m_Landmarks.NumLandmarks(), Microseconds(BuildStart) / 1000);
+        }
+    }
+
+    Prepared.m_HasNavGraph = pNavTuning != nullptr;
+    if(pNavTuning)
+    {
+        auto BuildStart = std::chrono::steady_clock::now();
+        CCollision Collision;
+        Collision.Init(&Prepared.m_TileLayer, &Prepared.m_Clearance);
+        Prepared.m_NavTuning = *pNavTuning;
+        Prepared.m_NavGraph.Build(Collision, *pNavTuning);
+        log_msgf("sugarcane/tws", "navigation graph: {} nodes, {} edges, built in {} ms", Prepared.m_NavGraph.NumNodes(), Prepared.m_NavGraph.NumEdges(), Microseconds(BuildStart) / 1000);
+    }
+    return true;
+}
+
+CMapWarmup::CMapWarmup()
+{
+    m_pStorage = nullptr;
+    m_NavGraph = false;
+    m_Landmarks = false;
+    m_Stop = false;
+}
+
+CMapWarmup::~CMapWarmup()
+{
+    Stop();
+}
+
+void CMapWarmup::Start(IStorage *pStorage, const std::vector<std::pair<std::string, std::string>>& vMaps, int Threads, const CTuningParams *pNavTuning, bool Landmarks)
+{
+    Stop();
+
+    m_pStorage = pStorage;
+    m_NavGraph = pNavTuning != nullptr;
+    if(pNavTuning)
+        m_NavTuning = *pNavTuning;
+    m_Landmarks = Landmarks;
+    for(const auto& Map : vMaps)
+        m_vJobs.push_back({Map.first, Map.second, JOB_QUEUED, nullptr});
+    for(int i = 0; i < std::min<int>(Threads, m_vJobs.size()); i++)
+        m_vThreads.emplace_back(&CMapWarmup::Run, this);
+}
+
+void CMapWarmup::Stop()
+{
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        m_Stop = true;
+    }
+    // a map being prepared is finished first
+    for(auto& Thread : m_vThreads)
+        Thread.join();
+    m_vThreads.clear();
+    m_vJobs.clear();
+    m_Stop = false;
+}
+
+bool CMapWarmup::Take(const char *pMap, const char *pCrc, std::unique_ptr<SPreparedMap>& pPrepared)
+{
+    std::unique_lock<std::mutex> Lock(m_Mutex);
+    for(SJob& Job : m_vJobs)
+    {
+        if(Job.m_Map != pMap || Job.m_Crc != pCrc)
+            continue;
+
+        // not started yet, the caller loads it sooner than a thread would
+        if(Job.m_State == JOB_QUEUED)
+        {
+            Job.m_State = JOB_DONE;
+            return false;
+        }
+        m_JobDone.wait(Lock, [&]() { return Job.m_State == JOB_DONE; });
+        pPrepared = std::move(Job.m_pPrepared);
+        return pPrepared != nullptr;
+    }
+    return false;
+}
+
+void CMapWarmup::Release()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_Stop = true;
+    for(SJob& Job : m_vJobs)
+    {
+        if(Job.m_State == JOB_QUEUED)
+            Job.m_State = JOB_DONE;
+        Job.m_pPrepared.reset();
+    }
+    m_JobDone.notify_all();
+}
+
+void CMapWarmup::Run()
+{
+    std::unique_lock<std::mutex> Lock(m_Mutex);
+    while(!m_Stop)
+    {
+        auto It = std::find_if(m_vJobs.begin(), m_vJobs.end(), [](const SJob& Job) { return Job.m_State == JOB_QUEUED; });
+        if(It == m_vJobs.end())
+            break;
+        SJob& Job = *It; // the job list does not change while threads run
+        Job.m_State = JOB_RUNNING;
+        Lock.unlock();
+
+        auto Start = std::chrono::steady_clock::now();
+        std::unique_ptr<SPreparedMap> pPrepared = std::make_unique<SPreparedMap>();
+        if(PrepareMap(m_pStorage, Job.m_Map.c_str(), Job.m_Crc.c_str(), nullptr, 0, m_NavGraph ? &m_NavTuning : nullptr, m_Landmarks, *pPrepared))
+            log_msgf("sugarcane/tws", "warm-up: {}/{} prepared in {} ms", Job.m_Map, Job.m_Crc, Microseconds(Start) / 1000);
+        else
+        {
+            log_msgf("sugarcane/tws", "warm-up: {}/{} failed", Job.m_Map, Job.m_Crc);
+            pPrepared.reset();
+        }
+
+        Lock.lock();
+        if(!m_Stop)
+            Job.m_pPrepared = std::move(pPrepared);
+        Job.m_State = JOB_DONE;
+        m_JobDone.notify_all();
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef TEEWORLDS_MAPWARMUP_H
+#define TEEWORLDS_MAPWARMUP_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <teeworlds/map/clearance.h>
+#include <teeworlds/map/tilelayer.h>
+#include <teeworlds/six/tune.h>
+
+#include "landmarks.h"
+#include "navgraph.h"
+#include "pathgrid.h"
+#include "pathhierarchy.h"
+
+class IStorage;
+
+// Everything the bot derives from a map before it can play on it. The
+// hierarchy points at m_PathGrid, rebind it when the grid is moved.
+struct SPreparedMap
+{
+    std::string m_Map;
+    std::string m_Crc;
+    CTileLayer m_TileLayer;
+    CClearanceField m_Clearance;
+    CPathGrid m_PathGrid;
+    CPathHierarchy m_PathHierarchy;
+    CLandmarks m_Landmarks;
+    bool m_HasLandmarks = false;
+    CNavGraph m_NavGraph;
+    CTuningParams m_NavTuning; // the tuning the graph was simulated with
+    bool m_HasNavGraph = false;
+};
+
+// Loads and preprocesses a map the way CSugarcane::LoadMap needs it. pData
+// holds the map file if the caller has it in memory.
+bool PrepareMap(IStorage *pStorage, const char *pMap, const char *pCrc, const void *pData, int Size, const CTuningParams *pNavTuning, bool Landmarks, SPreparedMap& Prepared);
+
+// Prepares maps the bot is likely to get on a few background threads, so
+// the map change only has to swap the results in.
+class CMapWarmup
+{
+public:
+    CMapWarmup();
+    ~CMapWarmup();
+
+    // vMaps are (name, crc) pairs, prepared in order. Without pNavTuning no
+    // navigation graph is built. A graph built with tuning the server does
+    // not use is simulated again by the path worker once the tuning arrives.
+    void Start(IStorage *pStorage, const std::vector<std::pair<std::string, std::string>>& vMaps, int Threads, const CTuningParams *pNavTuning, bool Landmarks);
+    void Stop();
+
+    // Moves a prepared map out, waiting for it while it is being prepared.
+    // False for maps the warm-up does not have, or could not prepare.
+    bool Take(const char *pMap, const char *pCrc, std::unique_ptr<SPreparedMap>& pPrepared);
+    // Frees the maps that were not taken and prepares no more, maps being
+    // prepared are dropped when they are done. Does not wait for them.
+    void Release();
+
+private:
+    enum
+    {
+        JOB_QUEUED = 0,
+        JOB_RUNNING,
+        JOB_DONE,
+    };
+
+    struct SJob
+    {
+        std::string m_Map;
+        std::string m_Crc;
+        int m_State;
+        std::unique_ptr<SPreparedMap> m_pPrepared; // null once taken or failed
+    };
+
+    IStorage *m_pStorage;
+    CTuningParams m_NavTuning;
+    bool m_NavGraph;
+    bool m_Landmarks;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_JobDone;
+    std::vector<SJob> m_vJobs;
+    bool m_Stop;
+    std::vector<std::thread> m_vThreads;
+
+    void Run();
+};
+
+#endif // TEEWORLDS_MAPWARMUP_H
@@ -0,0 +1,422 @@
+#include <include/base.h>
+
+#include <teeworlds/six/gamecore.h>
+
+#include "navgraph.h"
+
+#include <algorithm>
+#include <queue>
+#include <thread>
+
+enum
+{
+    NAV_MAX_TICKS = 75,
+    NAV_TAKEOFF_TICKS = 15,
+};
+
+static const float s_PhysSize = 28.0f;
+
+SNavInput NavActionInput(const SNavAction& Action, int Tick)
+{
+    SNavInput Input;
+    Input.m_Direction = Action.m_Direction;
+    Input.m_Jump = false;
+    Input.m_Hook = false;
+    Input.m_HookDir = vec2(0.0f, -1.0f);
+
+    switch(Action.m_Move)
+    {
+    case ENavMove::WALK:
+        break;
+    case ENavMove::JUMP:
+        Input.m_Jump = Tick == 0;
+        break;
+    case ENavMove::AIR_JUMP:
+        Input.m_Jump = Tick == 0 || Tick == Action.m_AirJumpTick;
+        break;
+    case ENavMove::HOOK:
+        Input.m_Hook = Tick < Action.m_HookTicks;
+        Input.m_HookDir = vec2(cosf(Action.m_HookAngle * pi / 180.0f), sinf(Action.m_HookAngle * pi / 180.0f));
+        break;
+    }
+    return Input;
+}
+
+void SNavTee::Reset(vec2 Pos)
+{
+    m_Pos = Pos;
+    m_Vel = vec2(0.0f, 0.0f);
+    m_HookPos = Pos;
+    m_HookDir = vec2(0.0f, 0.0f);
+    m_Jumped = 0;
+    m_HookState = HOOK_IDLE;
+    m_HookTick = 0;
+}
+
+bool SNavTee::Grounded(const CCollision& Collision) const
+{
+    return Collision.CheckPoint(m_Pos.x+s_PhysSize/2, m_Pos.y+s_PhysSize/2+5) || Collision.CheckPoint(m_Pos.x-s_PhysSize/2, m_Pos.y+s_PhysSize/2+5);
+}
+
+bool SNavTee::InDeath(const CCollision& Collision) const
+{
+    const float Offset = s_PhysSize/3.f;
+    return Collision.CheckPoint(m_Pos.x+Offset, m_Pos.y-Offset, ESMapItems::TILEFLAG_DEATH) ||
+        Collision.CheckPoint(m_Pos.x+Offset, m_Pos.y+Offset, ESMapItems::TILEFLAG_DEATH) ||
+        Collision.CheckPoint(m_Pos.x-Offset, m_Pos.y-Offset, ESMapItems::TILEFLAG_DEATH) ||
+        Collision.CheckPoint(m_Pos.x-Offset, m_Pos.y+Offset, ESMapItems::TILEFLAG_DEATH);
+}
+
+void SNavTee::Tick(const SNavInput& Input, const CCollision& Collision, const CTuningParams& Tuning)
+{
+    bool IsGrounded = Grounded(Collision);
+
+    m_Vel.y += Tuning.m_Gravity;
+
+    float MaxSpeed = IsGrounded ? Tuning.m_GroundControlSpeed : Tuning.m_AirControlSpeed;
+    float Accel = IsGrounded ? Tuning.m_GroundControlAccel : Tuning.m_AirControlAccel;
+    float Friction = IsGrounded ? Tuning.m_GroundFriction : Tuning.m_AirFriction;
+
+    if(Input.m_Direction < 0)
+        m_Vel.x = SaturatedAdd(-MaxSpeed, MaxSpeed, m_Vel.x, -Accel);
+    if(Input.m_Direction > 0)
+        m_Vel.x = SaturatedAdd(-MaxSpeed, MaxSpeed, m_Vel.x, Accel);
+    if(Input.m_Direction == 0)
+        m_Vel.x *= Friction;
+
+    // 1 bit = to keep track if a jump has been made on this input
+    // 2 bit = to keep track if a air-jump has been made
+    if(Input.m_Jump)
+    {
+        if(!(m_Jumped&1))
+        {
+            if(IsGrounded)
+            {
+                m_Vel.y = -Tuning.m_GroundJumpImpulse;
+                m_Jumped |= 1;
+            }
+            else if(!(m_Jumped&2))
+            {
+                m_Vel.y = -Tuning.m_AirJumpImpulse;
+                m_Jumped |= 3;
+            }
+        }
+    }
+    else
+        m_Jumped &= ~1;
+
+    if(Input.m_Hook)
+    {
+        if(m_HookState == HOOK_IDLE)
+        {
+            m_HookState = HOOK_FLYING;
+            m_HookPos = m_Pos+Input.m_HookDir*s_PhysSize*1.5f;
+            m_HookDir = Input.m_HookDir;
+            m_HookTick = 0;
+        }
+    }
+    else
+    {
+        m_HookState = HOOK_IDLE;
+        m_HookPos = m_Pos;
+    }
+
+    if(IsGrounded)
+        m_Jumped &= ~2;
+
+    if(m_HookState == HOOK_IDLE)
+        m_HookPos = m_Pos;
+    else if(m_HookState >= HOOK_RETRACT_START && m_HookState < HOOK_RETRACT_END)
+        m_HookState++;
+    else if(m_HookState == HOOK_RETRACT_END)
+        m_HookState = HOOK_RETRACTED;
+    else if(m_HookState == HOOK_FLYING)
+    {
+        vec2 NewPos = m_HookPos+m_HookDir*Tuning.m_HookFireSpeed;
+        if(distance(m_Pos, NewPos) > Tuning.m_HookLength)
+        {
+            m_HookState = HOOK_RETRACT_START;
+            NewPos = m_Pos + normalize(NewPos-m_Pos) * Tuning.m_HookLength;
+        }
+
+        ESMapItems Hit = Collision.IntersectLine(m_HookPos, NewPos, &NewPos, 0);
+        if(Hit != ESMapItems::TILEFLAG_AIR)
+            m_HookState = (Hit&ESMapItems::TILEFLAG_UNHOOKABLE) ? HOOK_RETRACT_START : HOOK_GRABBED;
+        m_HookPos = NewPos;
+    }
+
+    if(m_HookState == HOOK_GRABBED)
+    {
+        if(distance(m_HookPos, m_Pos) > 46.0f)
+        {
+            vec2 HookVel = normalize(m_HookPos-m_Pos)*Tuning.m_HookDragAccel;
+            // the hook as more power to drag you up then down.
+            // this makes it easier to get on top of an platform
+            if(HookVel.y > 0)
+                HookVel.y *= 0.3f;
+
+            // the hook will boost it's power if the player wants to move
+            // in that direction. otherwise it will dampen everything abit
+            if((HookVel.x < 0 && Input.m_Direction < 0) || (HookVel.x > 0 && Input.m_Direction > 0))
+                HookVel.x *= 0.95f;
+            else
+                HookVel.x *= 0.75f;
+
+            vec2 NewVel = m_Vel+HookVel;
+
+            // check if we are under the legal limit for the hook
+            if(length(NewVel) < Tuning.m_HookDragSpeed || length(NewVel) < length(m_Vel))
+                m_Vel = NewVel; // no problem. apply
+        }
+        m_HookTick++;
+    }
+
+    // clamp the velocity to something sane
+    if(length(m_Vel) > 6000)
+        m_Vel = normalize(m_Vel) * 6000;
+
+    // move
+    float RampValue = VelocityRamp(length(m_Vel)*50, Tuning.m_VelrampStart, Tuning.m_VelrampRange, Tuning.m_VelrampCurvature);
+
+    m_Vel.x = m_Vel.x*RampValue;
+    Collision.MoveBox(&m_Pos, &m_Vel, vec2(s_PhysSize, s_PhysSize), 0);
+    m_Vel.x = m_Vel.x*(1.0f/RampValue);
+}
+
+CNavGraph::CNavGraph()
+{
+    Clear();
+}
+
+void CNavGraph::Clear()
+{
+    m_Width = 0;
+    m_Height = 0;
+    m_vNodeOf.clear();
+    m_vNodeTile.clear();
+    m_vEdges.clear();
+    m_vOutStart.assign(1, 0);
+    m_vInEdges.clear();
+    m_vInStart.assign(1, 0);
+}
+
+int CNavGraph::NodeAt(int TileX, int TileY) const
+{
+    if(TileX < 0 || TileX >= m_Width || TileY < 0 || TileY >= m_Height)
+        return -1;
+    return m_vNodeOf[TileY * m_Width + TileX];
+}
+
+int CNavGraph::FindNode(vec2 Pos) const
+{
+    int TileY = round_to_int(Pos.y) / 32;
+    int Node = NodeAt(round_to_int(Pos.x) / 32, TileY);
+    if(Node >= 0)
+        return Node;
+
+    // standing on a ledge with only one foot
+    Node = NodeAt(round_to_int(Pos.x - s_PhysSize / 2) / 32, TileY);
+    if(Node >= 0)
+        return Node;
+    return NodeAt(round_to_int(Pos.x + s_PhysSize / 2) / 32, TileY);
+}
+
+int CNavGraph::FindNodeBelow(vec2 Pos, int MaxTiles) const
+{
+    int TileX = round_to_int(Pos.x) / 32;
+    int TileY = round_to_int(Pos.y) / 32;
+    for(int i = 0; i <= MaxTiles; i++)
+    {
+        int Node = NodeAt(TileX, TileY + i);
+        if(Node >= 0)
+            return Node;
+    }
+    return -1;
+}
+
+void CNavGraph::Simulate(const CCollision& Collision, const CTuningParams& Tuning, int Node, const SNavAction& Action, std::vector<SNavEdge>& vEdges) const
+{
+    SNavTee Tee;
+    Tee.Reset(NodePos(Node));
+
+    bool Airborne = false;
+    for(int Tick = 0; Tick < NAV_MAX_TICKS; Tick++)
+    {
+        Tee.Tick(NavActionInput(Action, Tick), Collision, Tuning);
+        if(Tee.InDeath(Collision))
+            return;
+
+        // a hook that found nothing to grab is just a standing still
+        if(Action.m_Move == ENavMove::HOOK && !Airborne && Tee.m_HookState != HOOK_FLYING && Tee.m_HookState != HOOK_GRABBED)
+            return;
+
+        if(!Tee.Grounded(Collision))
+        {
+            Airborne = true;
+            continue;
+        }
+        if(!Airborne && Action.m_Move != ENavMove::WALK && Tick >= NAV_TAKEOFF_TICKS)
+            return;
+        if(Tee.m_Vel.y < 0.0f)
+            continue;
+        if(Action.m_Move == ENavMove::HOOK && Tick < Action.m_HookTicks)
+            continue;
+        if(Action.m_Move == ENavMove::AIR_JUMP && Tick < Action.m_AirJumpTick)
+            continue;
+
+        // walks end on the first other node, everything else on landing
+        int To = FindNode(Tee.m_Pos);
+        if(Action.m_Move == ENavMove::WALK ? To >= 0 && To != Node : Airborne)
+        {
+            if(To >= 0 && To != Node)
+            {
+                SNavAction Taken = Action;
+                Taken.m_Ticks = Tick + 1;
+                vEdges.push_back({Node, To, Tick + 1, Taken});
+            }
+            return;
+        }
+    }
+}
+
+void CNavGraph::Build(const CCollision& Collision, const CTuningParams& Tuning)
+{
+    Clear();
+    m_Width = Collision.Width();
+    m_Height = Collision.Height();
+    m_vNodeOf.assign(m_Width * m_Height, -1);
+
+    for(int y = 0; y < m_Height - 1; y++)
+    {
+        for(int x = 0; x < m_Width; x++)
+        {
+            ESMapItems Tile = Collision.GetTileAt(x, y);
+            if(Tile & (ESMapItems::TILEFLAG_SOLID | ESMapItems::TILEFLAG_DEATH))
+                continue;
+            if(!(Collision.GetTileAt(x, y + 1) & ESMapItems::TILEFLAG_SOLID))
+                continue;
+            m_vNodeOf[y * m_Width + x] = m_vNodeTile.size();
+            m_vNodeTile.push_back(y * m_Width + x);
+        }
+    }
+
+    // the moves tried from every node
+    std::vector<SNavAction> vActions;
+    for(int Direction = -1; Direction <= 1; Direction += 2)
+        vActions.push_back({ENavMove::WALK, (int8_t) Direction, 0, 0, 0, 0});
+    for(int Direction = -1; Direction <= 1; Direction++)
+    {
+        vActions.push_back({ENavMove::JUMP, (int8_t) Direction, 0, 0, 0, 0});
+        vActions.push_back({ENavMove::AIR_JUMP, (int8_t) Direction, 12, 0, 0, 0});
+    }
+    for(int Angle = -150; Angle <= -30; Angle += 20)
+    {
+        int Direction = Angle < -90 ? -1 : Angle > -90 ? 1 : 0;
+        for(int HookTicks : {15, 30})
+        {
+            vActions.push_back({ENavMove::HOOK, (int8_t) Direction, 0, (uint8_t) HookTicks, (int16_t) Angle, 0});
+        }
+    }
+
+    // nodes are independent, so split them over a few threads and join
+    // the per-thread edge lists in node order afterwards
+    int NumThreads = clamp((int) std::thread::hardware_concurrency(), 1, 8);
+    NumThreads = std::min(NumThreads, std::max(NumNodes() / 64, 1));
+    std::vector<std::vector<SNavEdge>> vvThreadEdges(NumThreads);
+    auto Worker = [&](int Thread)
+    {
+        std::vector<SNavEdge>& vEdges = vvThreadEdges[Thread];
+        int Begin = (int64_t) NumNodes() * Thread / NumThreads;
+        int End = (int64_t) NumNodes() * (Thread + 1) / NumThreads;
+        for(int Node = Begin; Node < End; Node++)
+        {
+            size_t First = vEdges.size();
+            for(const SNavAction& Action : vActions)
+                Simulate(Collision, Tuning, Node, Action, vEdges);
+
+            // keep the cheapest move to every target
+            std::sort(vEdges.begin() + First, vEdges.end(), [](const SNavEdge& A, const SNavEdge& B)
+            {
+                return A.m_To != B.m_To ? A.m_To < B.m_To : A.m_Cost < B.m_Cost;
+            });
+            vEdges.erase(std::unique(vEdges.begin() + First, vEdges.end(), [](const SNavEdge& A, const SNavEdge& B)
+            {
+                return A.m_To == B.m_To;
+            }), vEdges.end());
+        }
+    };
+
+    std::vector<std::thread> vThreads;
+    for(int Thread = 1; Thread < NumThreads; Thread++)
+        vThreads.emplace_back(Worker, Thread);
+    Worker(0);
+    for(auto& Thread : vThreads)
+        Thread.join();
+
+    std::vector<SNavEdge> vEdges;
+    for(auto& vThreadEdges : vvThreadEdges)
+        vEdges.insert(vEdges.end(), vThreadEdges.begin(), vThreadEdges.end());
+    m_vEdges = std::move(vEdges);
+
+    m_vOutStart.assign(NumNodes() + 1, 0);
+    m_vInStart.assign(NumNodes() + 1, 0);
+    for(const SNavEdge& Edge : m_vEdges)
+    {
+        m_vOutStart[Edge.m_From + 1]++;
+        m_vInStart[Edge.m_To + 1]++;
+    }
+    for(int Node = 0; Node < NumNodes(); Node++)
+    {
+        m_vOutStart[Node + 1] += m_vOutStart[Node];
+        m_vInStart[Node + 1] += m_vInStart[Node];
+    }
+
+    m_vInEdges.resize(m_vEdges.size());
+    std::vector<int> vFill(m_vInStart.begin(), m_vInStart.end() - 1);
+    for(int i = 0; i < NumEdges(); i++)
+        m_vInEdges[vFill[m_vEdges[i].m_To]++] = i;
+}
+
+CNavField::CNavField()
+{
+    Clear();
+}
+
+void CNavField::Clear()
+{
+    m_Goal = -1;
+    m_vCost.clear();
+    m_vNext.clear();
+}
+
+void CNavField::Build(const CNavGraph& Graph, int GoalNode)
+{
+    m_Goal = GoalNode;
+    m_vCost.assign(Graph.NumNodes(), UNREACHED);
+    m_vNext.assign(Graph.NumNodes(), -1);
+    if(GoalNode < 0 || GoalNode >= Graph.NumNodes())
+        return;
+
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> Queue;
+    m_vCost[GoalNode] = 0;
+    Queue.push({0, GoalNode});
+    while(!Queue.empty())
+    {
+        auto [Cost, Node] = Queue.top();
+        Queue.pop();
+        if(Cost > m_vCost[Node])
+            continue;
+
+        for(int i = Graph.InBegin(Node); i < Graph.InEnd(Node); i++)
+        {
+            const SNavEdge& Edge = Graph.Edge(Graph.InEdge(i));
+            int NewCost = Cost + Edge.m_Cost;
+            if(NewCost < m_vCost[Edge.m_From])
+            {
+                m_vCost[Edge.m_From] = NewCost;
+                m_vNext[Edge.m_From] = Graph.InEdge(i);
+                Queue.push({NewCost, Edge.m_From});
+            }
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef TEEWORLDS_NAVGRAPH_H
+#define TEEWORLDS_NAVGRAPH_H
+
+#include <teeworlds/map/collision.h>
+#include <teeworlds/six/tune.h>
+
+#include <cstdint>
+#include <vector>
+
+enum class ENavMove : uint8_t
+{
+    WALK,
+    JUMP,
+    AIR_JUMP,
+    HOOK,
+};
+
+// Input script of one edge, replayed tick by tick from the moment the tee
+// stands on the source node.
+struct SNavAction
+{
+    ENavMove m_Move;
+    int8_t m_Direction;
+    uint8_t m_AirJumpTick; // air jumps only
+    uint8_t m_HookTicks; // hooks only, how long the hook is held
+    int16_t m_HookAngle; // hooks only, degrees, -90 is straight up
+    uint16_t m_Ticks; // simulated duration until landing
+};
+
+struct SNavInput
+{
+    int m_Direction;
+    bool m_Jump;
+    bool m_Hook;
+    vec2 m_HookDir;
+};
+
+SNavInput NavActionInput(const SNavAction& Action, int Tick);
+
+// A lone tee without other players, stepped like the server core does.
+struct SNavTee
+{
+    vec2 m_Pos;
+    vec2 m_Vel;
+    vec2 m_HookPos;
+    vec2 m_HookDir;
+    int m_Jumped;
+    int m_HookState;
+    int m_HookTick;
+
+    void Reset(vec2 Pos);
+    bool Grounded(const CCollision& Collision) const;
+    bool InDeath(const CCollision& Collision) const;
+    void Tick(const SNavInput& Input, const CCollision& Collision, const CTuningParams& Tuning);
+};
+
+struct SNavEdge
+{
+    int m_From;
+    int m_To;
+    int m_Cost; // ticks
+    SNavAction m_Action;
+};
+
+// Standable tiles of a map linked by the moves a tee can actually perform
+// from them: walking (and walking off ledges), ground jumps, air jumps and
+// hook swings. Edges are found by simulating each move with the tuning of
+// the map, so the graph only contains paths the tee can follow.
+class CNavGraph
+{
+    int m_Width;
+    int m_Height;
+    std::vector<int> m_vNodeOf; // tile -> node, -1 if not standable
+    std::vector<int> m_vNodeTile; // node -> tile
+    std::vector<SNavEdge> m_vEdges; // sorted by source node
+    std::vector<int> m_vOutStart; // node -> first outgoing edge, NumNodes + 1 entries
+    std::vector<int> m_vInEdges; // edge indices sorted by target node
+    std::vector<int> m_vInStart;
+
+    void Simulate(const CCollision& Collision, const CTuningParams& Tuning, int Node, const SNavAction& Action, std::vector<SNavEdge>& vEdges) const;
+
+public:
+    CNavGraph();
+
+    void Build(const CCollision& Collision, const CTuningParams& Tuning);
+    void Clear();
+
+    int Width() const { return m_Width; }
+    int Height() const { return m_Height; }
+    int NumNodes() const { return m_vNodeTile.size(); }
+    int NumEdges() const { return m_vEdges.size(); }
+
+    int NodeAt(int TileX, int TileY) const;
+    int NodeTileX(int Node) const { return m_vNodeTile[Node] % m_Width; }
+    int NodeTileY(int Node) const { return m_vNodeTile[Node] / m_Width; }
+    vec2 NodePos(int Node) const { return vec2(NodeTileX(Node) * 32 + 16, NodeTileY(Node) * 32 + 16); }
+
+    // node the tee is standing on, -1 if it is not on one
+    int FindNode(vec2 Pos) const;
+    // first node at or below Pos, looking at most MaxTiles down
+    int FindNodeBelow(vec2 Pos, int MaxTiles) const;
+
+    const SNavEdge& Edge(int Index) const { return m_vEdges[Index]; }
+    int OutBegin(int Node) const { return m_vOutStart[Node]; }
+    int OutEnd(int Node) const { return m_vOutStart[Node + 1]; }
+    int InBegin(int Node) const { return m_vInStart[Node]; }
+    int InEnd(int Node) const { return m_vInStart[Node + 1]; }
+    int InEdge(int Index) const { return m_vInEdges[Index]; }
+};
+
+// Cost-to-go in ticks from every node to one goal node, with the edge to
+// take next. Built by a reverse Dijkstra over the graph.
+class CNavField
+{
+    int m_Goal;
+    std::vector<int> m_vCost;
+    std::vector<int> m_vNext;
+
+public:
+    static constexpr int UNREACHED = 0x7fffffff;
+
+    CNavField();
+
+    void Build(const CNavGraph& Graph, int GoalNode);
+    void Clear();
+
+    int Goal() const { return m_Goal; }
+    int Cost(int Node) const { return Node >= 0 && Node < (int) m_vCost.size() ? m_vCost[Node] : UNREACHED; }
+    // index of the edge to follow from Node, -1 at the goal or if unreachable
+    int NextEdge(int Node) const { return Node >= 0 && Node < (int) m_vNext.size() ? m_vNext[Node] : -1; }
+};
+
+#endif // TEEWORLDS_NAVGRAPH_H
@@ -0,0 +1,98 @@
+#ifndef TEEWORLDS_PATHGRID_H
+#define TEEWORLDS_PATHGRID_H
+
+#include <cstdint>
+#include <vector>
+
+#include "map/tilelayer.h"
+
+// Walkability of every tile, classified exactly like AStar does: a tile is
+// open if it is air and neither it nor the tile below it is deadly. Shared
+// by the path layers that do not keep a full distance field.
+class CPathGrid
+{
+public:
+    enum
+    {
+        CELL_VALID = 1 << 0,
+        CELL_DANGEROUS = 1 << 1,
+    };
+
+    CPathGrid() :
+        m_Rows(0), m_Cols(0) {}
+
+    void Build(const std::vector<std::vector<int>>& Grid)
+    {
+        m_Rows = Grid.size();
+        m_Cols = m_Rows ? Grid[0].size() : 0;
+        m_vCells.resize(m_Rows * m_Cols);
+        for(int y = 0; y < m_Rows; y++)
+            for(int x = 0; x < m_Cols; x++)
+                m_vCells[y * m_Cols + x] = Classify(Grid[y][x], y < m_Rows - 1 ? Grid[y + 1][x] : 0, y < m_Rows - 1);
+    }
+
+    void Build(const CTileLayer& Layer)
+    {
+        m_Rows = Layer.Height();
+        m_Cols = Layer.Width();
+        m_vCells.resize(m_Rows * m_Cols);
+        for(int y = 0; y < m_Rows; y++)
+            for(int x = 0; x < m_Cols; x++)
+                m_vCells[y * m_Cols + x] = Classify(Layer.GridValue(x, y), y < m_Rows - 1 ? Layer.GridValue(x, y + 1) : 0, y < m_Rows - 1);
+    }
+
+    void Clear()
+    {
+        m_Rows = 0;
+        m_Cols = 0;
+        m_vCells.clear();
+    }
+
+    // Reclassify the given cell indices, GetCell(y, x) returning the new
+    // grid value. Cells that opened or closed are appended to vFlipped.
+    template<typename FGetCell>
+    void Update(const std::vector<int>& vChanged, FGetCell&& GetCell, std::vector<int>& vFlipped)
+    {
+        for(int Changed : vChanged)
+        {
+            if(Changed < 0 || Changed >= m_Rows * m_Cols)
+                continue;
+            // danger also looks one row down
+            for(int Cell : {Changed, Changed - m_Cols})
+            {
+                if(Cell < 0)
+                    continue;
+                int y = Cell / m_Cols;
+                int x = Cell % m_Cols;
+                uint8_t Flags = Classify(GetCell(y, x), y < m_Rows - 1 ? GetCell(y + 1, x) : 0, y < m_Rows - 1);
+                if((Flags == CELL_VALID) != (m_vCells[Cell] == CELL_VALID))
+                    vFlipped.push_back(Cell);
+                m_vCells[Cell] = Flags;
+            }
+        }
+    }
+
+    bool Loaded() const { return m_Rows > 0 && m_Cols > 0; }
+    int Rows() const { return m_Rows; }
+    int Cols() const { return m_Cols; }
+
+    bool Inside(int y, int x) const { return y >= 0 && y < m_Rows && x >= 0 && x < m_Cols; }
+    bool IsOpen(int Cell) const { return m_vCells[Cell] == CELL_VALID; }
+    bool IsOpen(int y, int x) const { return Inside(y, x) && m_vCells[y * m_Cols + x] == CELL_VALID; }
+    bool IsDangerous(int y, int x) const { return Inside(y, x) && (m_vCells[y * m_Cols + x] & CELL_DANGEROUS); }
+
+private:
+    int m_Rows;
+    int m_Cols;
+    std::vector<uint8_t> m_vCells;
+
+    static uint8_t Classify(int Value, int Below, bool HasBelow)
+    {
+        uint8_t Flags = Value == 0 ? CELL_VALID : 0;
+        if(HasBelow && (Value == -1 || Below == -1))
+            Flags |= CELL_DANGEROUS;
+        return Flags;
+    }
+};
+
+#endif // TEEWORLDS_PATHGRID_H
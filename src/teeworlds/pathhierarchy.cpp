@@ -0,0 +1,481 @@
+#include <include/base.h>
+
+#include <teeworlds/six/math.h>
+
+#include "pathhierarchy.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <queue>
+
+enum
+{
+    SIDE_UP,
+    SIDE_DOWN,
+    SIDE_LEFT,
+    SIDE_RIGHT,
+    NUM_SIDES,
+
+    // runs at least this long get an entrance at both ends
+    WIDE_ENTRANCE = 6,
+};
+
+static const std::pair<int, int> s_aDirections[] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+
+CPathHierarchy::CPathHierarchy()
+{
+    Clear();
+}
+
+void CPathHierarchy::Clear()
+{
+    m_pGrid = nullptr;
+    m_Rows = 0;
+    m_Cols = 0;
+    m_ClustersX = 0;
+    m_ClustersY = 0;
+    m_NumNodes = 0;
+    m_LastRebuilt = 0;
+    m_vClusters.clear();
+    m_FieldValid = false;
+}
+
+void CPathHierarchy::Build(const CPathGrid& Grid)
+{
+    Clear();
+    m_pGrid = &Grid;
+    m_Rows = Grid.Rows();
+    m_Cols = Grid.Cols();
+    if(!m_Rows || !m_Cols)
+        return;
+
+    m_ClustersX = (m_Cols + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+    m_ClustersY = (m_Rows + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+    m_vClusters.resize(m_ClustersX * m_ClustersY);
+    m_vLocal.resize(CLUSTER_SIZE * CLUSTER_SIZE);
+
+    m_vDirty.clear();
+    for(int Cluster = 0; Cluster < NumClusters(); Cluster++)
+        m_vDirty.push_back(Cluster);
+    RebuildDirty();
+}
+
+void CPathHierarchy::Update(const std::vector<int>& vFlipped)
+{
+    if(!Built() || vFlipped.empty())
+        return;
+
+    m_vDirty.clear();
+    for(int Cell : vFlipped)
+        m_vDirty.push_back(ClusterOf(Cell));
+    RebuildDirty();
+}
+
+int CPathHierarchy::NodeOf(int Cluster, int Cell) const
+{
+    const SCluster& Info = m_vClusters[Cluster];
+    for(int i = 0; i < (int) Info.m_vNodes.size(); i++)
+        if(Info.m_vNodes[i] == Cell)
+            return i;
+    return -1;
+}
+
+void CPathHierarchy::AddBorderEntrances(int Cluster, int Side)
+{
+    int X0 = Cluster % m_ClustersX * CLUSTER_SIZE;
+    int Y0 = Cluster / m_ClustersX * CLUSTER_SIZE;
+    int X1 = std::min(X0 + CLUSTER_SIZE, m_Cols);
+    int Y1 = std::min(Y0 + CLUSTER_SIZE, m_Rows);
+
+    // walk along the border: own cell at (y, x), the other side at (y + dy, x + dx)
+    bool Horizontal = Side == SIDE_UP || Side == SIDE_DOWN;
+    int y = Side == SIDE_UP ? Y0 : Side == SIDE_DOWN ? Y1 - 1 : Y0;
+    int x = Side == SIDE_LEFT ? X0 : Side == SIDE_RIGHT ? X1 - 1 : X0;
+    int dy = Side == SIDE_UP ? -1 : Side == SIDE_DOWN ? 1 : 0;
+    int dx = Side == SIDE_LEFT ? -1 : Side == SIDE_RIGHT ? 1 : 0;
+    int Length = Horizontal ? X1 - X0 : Y1 - Y0;
+    if(y + dy < 0 || y + dy >= m_Rows || x + dx < 0 || x + dx >= m_Cols)
+        return; // map border
+
+    SCluster& Info = m_vClusters[Cluster];
+    auto AddEntrance = [&](int Step)
+    {
+        int Cell = (y + (Horizontal ? 0 : Step)) * m_Cols + x + (Horizontal ? Step : 0);
+        int Partner = Cell + dy * m_Cols + dx;
+        int Node = NodeOf(Cluster, Cell);
+        if(Node < 0)
+        {
+            Node = Info.m_vNodes.size();
+            Info.m_vNodes.push_back(Cell);
+            Info.m_vvPartners.emplace_back();
+        }
+        Info.m_vvPartners[Node].push_back(Partner);
+    };
+
+    int RunStart = -1;
+    for(int Step = 0; Step <= Length; Step++)
+    {
+        int OwnY = y + (Horizontal ? 0 : Step);
+        int OwnX = x + (Horizontal ? Step : 0);
+        bool Open = Step < Length && IsOpen(OwnY, OwnX) && IsOpen(OwnY + dy, OwnX + dx);
+        if(Open && RunStart < 0)
+            RunStart = Step;
+        else if(!Open && RunStart >= 0)
+        {
+            int RunEnd = Step - 1;
+            if(RunEnd - RunStart + 1 >= WIDE_ENTRANCE)
+            {
+                AddEntrance(RunStart);
+                AddEntrance(RunEnd);
+            }
+            else
+                AddEntrance((RunStart + RunEnd) / 2);
+            RunStart = -1;
+        }
+    }
+}
+
+void CPathHierarchy::BuildClusterNodes(int Cluster)
+{
+    SCluster& Info = m_vClusters[Cluster];
+    Info.m_vNodes.clear();
+    Info.m_vvPartners.clear();
+    for(int Side = 0; Side < NUM_SIDES; Side++)
+        AddBorderEntrances(Cluster, Side);
+}
+
+void CPathHierarchy::BuildClusterCosts(int Cluster)
+{
+    SCluster& Info = m_vClusters[Cluster];
+    int Count = Info.m_vNodes.size();
+    Info.m_vCost.assign(Count * Count, UNREACHED);
+    for(int i = 0; i < Count; i++)
+    {
+        LocalBfs(Cluster, Info.m_vNodes[i]);
+        for(int j = 0; j < Count; j++)
+            Info.m_vCost[i * Count + j] = LocalDistance(Cluster, Info.m_vNodes[j]);
+    }
+}
+
+void CPathHierarchy::RebuildDirty()
+{
+    // a changed cell moves the entrances of the borders around its cluster,
+    // which are shared with the neighbouring clusters
+    m_vMarked.assign(m_vClusters.size(), 0);
+    for(int Cluster : m_vDirty)
+    {
+        int cx = Cluster % m_ClustersX;
+        int cy = Cluster / m_ClustersX;
+        m_vMarked[Cluster] = 1;
+        if(cx > 0)
+            m_vMarked[Cluster - 1] = 1;
+        if(cx + 1 < m_ClustersX)
+            m_vMarked[Cluster + 1] = 1;
+        if(cy > 0)
+            m_vMarked[Cluster - m_ClustersX] = 1;
+        if(cy + 1 < m_ClustersY)
+            m_vMarked[Cluster + m_ClustersX] = 1;
+    }
+
+    m_LastRebuilt = 0;
+    for(int Cluster = 0; Cluster < NumClusters(); Cluster++)
+    {
+        if(m_vMarked[Cluster])
+            BuildClusterNodes(Cluster);
+    }
+    for(int Cluster = 0; Cluster < NumClusters(); Cluster++)
+    {
+        if(m_vMarked[Cluster])
+        {
+            BuildClusterCosts(Cluster);
+            m_LastRebuilt++;
+        }
+    }
+
+    m_NumNodes = 0;
+    for(auto& Info : m_vClusters)
+    {
+        Info.m_FirstNode = m_NumNodes;
+        m_NumNodes += Info.m_vNodes.size();
+    }
+    m_FieldValid = false;
+}
+
+void CPathHierarchy::LocalBfs(int Cluster, int Cell)
+{
+    int X0 = Cluster % m_ClustersX * CLUSTER_SIZE;
+    int Y0 = Cluster / m_ClustersX * CLUSTER_SIZE;
+    int X1 = std::min(X0 + CLUSTER_SIZE, m_Cols);
+    int Y1 = std::min(Y0 + CLUSTER_SIZE, m_Rows);
+
+    std::fill(m_vLocal.begin(), m_vLocal.end(), UNREACHED);
+    m_vQueue.clear();
+
+    // the source may itself be closed, like a goal inside a wall
+    m_vLocal[(Cell / m_Cols - Y0) * CLUSTER_SIZE + Cell % m_Cols - X0] = 0;
+    m_vQueue.push_back(Cell);
+    for(size_t Head = 0; Head < m_vQueue.size(); Head++)
+    {
+        int Current = m_vQueue[Head];
+        int y = Current / m_Cols;
+        int x = Current % m_Cols;
+        uint16_t Next = m_vLocal[(y - Y0) * CLUSTER_SIZE + x - X0] + 1;
+
+        auto Visit = [&](int ny, int nx)
+        {
+            if(ny < Y0 || ny >= Y1 || nx < X0 || nx >= X1 || !IsOpen(ny, nx))
+                return;
+            uint16_t& Distance = m_vLocal[(ny - Y0) * CLUSTER_SIZE + nx - X0];
+            if(Next < Distance)
+            {
+                Distance = Next;
+                m_vQueue.push_back(ny * m_Cols + nx);
+            }
+        };
+
+        Visit(y, x + 1);
+        Visit(y + 1, x);
+        Visit(y, x - 1);
+        Visit(y - 1, x);
+    }
+}
+
+int CPathHierarchy::ClusterOfNode(int Node) const
+{
+    return std::upper_bound(m_vClusters.begin(), m_vClusters.end(), Node, [](int Id, const SCluster& Info)
+    {
+        return Id < Info.m_FirstNode;
+    }) - m_vClusters.begin() - 1;
+}
+
+uint16_t CPathHierarchy::LocalDistance(int Cluster, int Cell) const
+{
+    int X0 = Cluster % m_ClustersX * CLUSTER_SIZE;
+    int Y0 = Cluster / m_ClustersX * CLUSTER_SIZE;
+    return m_vLocal[(Cell / m_Cols - Y0) * CLUSTER_SIZE + Cell % m_Cols - X0];
+}
+
+void CPathHierarchy::BuildGoalField(int GoalCell)
+{
+    m_FieldGoal = GoalCell;
+    m_FieldValid = true;
+
+    // a goal inside a wall is still entered from its open neighbours, which
+    // may lie in other clusters than the goal itself
+    m_vGoalEntries.clear();
+    m_vGoalEntries.push_back({GoalCell, 0});
+    int GoalY = GoalCell / m_Cols;
+    int GoalX = GoalCell % m_Cols;
+    for(const auto& [dy, dx] : s_aDirections)
+    {
+        if(IsOpen(GoalY + dy, GoalX + dx) && ClusterOf((GoalY + dy) * m_Cols + GoalX + dx) != ClusterOf(GoalCell))
+            m_vGoalEntries.push_back({(GoalY + dy) * m_Cols + GoalX + dx, 1});
+    }
+
+    m_vGoalCost.assign(m_NumNodes, std::numeric_limits<int>::max());
+    m_vGoalNext.assign(m_NumNodes, -1);
+
+    // the abstract graph is undirected, so a Dijkstra from the entrances
+    // around the goal gives every entrance its cost to go
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> Queue;
+    for(const auto& [EntryCell, EntryCost] : m_vGoalEntries)
+    {
+        int Cluster = ClusterOf(EntryCell);
+        const SCluster& Info = m_vClusters[Cluster];
+        LocalBfs(Cluster, EntryCell);
+        for(size_t i = 0; i < Info.m_vNodes.size(); i++)
+        {
+            uint16_t Cost = LocalDistance(Cluster, Info.m_vNodes[i]);
+            if(Cost == UNREACHED || EntryCost + Cost >= m_vGoalCost[Info.m_FirstNode + i])
+                continue;
+            m_vGoalCost[Info.m_FirstNode + i] = EntryCost + Cost;
+            Queue.push({EntryCost + Cost, (int) (Info.m_FirstNode + i)});
+        }
+    }
+
+    while(!Queue.empty())
+    {
+        auto [Cost, Node] = Queue.top();
+        Queue.pop();
+        if(Cost > m_vGoalCost[Node])
+            continue;
+
+        int Cluster = ClusterOfNode(Node);
+        const SCluster& Info = m_vClusters[Cluster];
+        int Local = Node - Info.m_FirstNode;
+        auto Relax = [&](int Other, int NewCost)
+        {
+            if(NewCost >= m_vGoalCost[Other])
+                return;
+            m_vGoalCost[Other] = NewCost;
+            m_vGoalNext[Other] = Node;
+            Queue.push({NewCost, Other});
+        };
+
+        int Count = Info.m_vNodes.size();
+        for(int j = 0; j < Count; j++)
+        {
+            uint16_t Step = Info.m_vCost[j * Count + Local];
+            if(j != Local && Step != UNREACHED)
+                Relax(Info.m_FirstNode + j, Cost + Step);
+        }
+        for(int Partner : Info.m_vvPartners[Local])
+        {
+            int PartnerCluster = ClusterOf(Partner);
+            int PartnerNode = NodeOf(PartnerCluster, Partner);
+            if(PartnerNode >= 0)
+                Relax(m_vClusters[PartnerCluster].m_FirstNode + PartnerNode, Cost + 1);
+        }
+    }
+}
+
+int CPathHierarchy::NodeCell(int Node) const
+{
+    const SCluster& Info = m_vClusters[ClusterOfNode(Node)];
+    return Info.m_vNodes[Node - Info.m_FirstNode];
+}
+
+std::vector<std::pair<int, int>> CPathHierarchy::FindPath(std::pair<int, int> Start, std::pair<int, int> Goal, int MaxLength)
+{
+    auto [StartY, StartX] = Start;
+    if(!Built() || StartY < 0 || StartY >= m_Rows || StartX < 0 || StartX >= m_Cols)
+        return {};
+    if(!IsOpen(StartY, StartX) && !IsDangerous(StartY, StartX))
+        return {}; // Start is invalid
+
+    int GoalCell = clamp(Goal.first, 0, m_Rows - 1) * m_Cols + clamp(Goal.second, 0, m_Cols - 1);
+    int StartCell = StartY * m_Cols + StartX;
+    if(StartCell == GoalCell)
+        return {};
+
+    if(!m_FieldValid || m_FieldGoal != GoalCell)
+        BuildGoalField(GoalCell);
+
+    // leave the start through whichever entrance of its cluster is the
+    // cheapest overall, or walk to the goal directly if it is closer
+    int StartCluster = ClusterOf(StartCell);
+    const SCluster& StartInfo = m_vClusters[StartCluster];
+    LocalBfs(StartCluster, StartCell);
+
+    int Best = std::numeric_limits<int>::max();
+    int DirectCell = -1;
+    for(const auto& [EntryCell, EntryCost] : m_vGoalEntries)
+    {
+        if(ClusterOf(EntryCell) != StartCluster)
+            continue;
+        int Cost = LocalDistance(StartCluster, EntryCell);
+        if(Cost == UNREACHED)
+        {
+            // the goal itself may be closed, it is reached through a neighbour
+            int EntryY = EntryCell / m_Cols;
+            int EntryX = EntryCell % m_Cols;
+            for(const auto& [dy, dx] : s_aDirections)
+            {
+                int Neighbour = (EntryY + dy) * m_Cols + EntryX + dx;
+                if(IsOpen(EntryY + dy, EntryX + dx) && ClusterOf(Neighbour) == StartCluster && LocalDistance(StartCluster, Neighbour) != UNREACHED)
+                    Cost = std::min<int>(Cost, LocalDistance(StartCluster, Neighbour) + 1);
+            }
+        }
+        if(Cost == UNREACHED || Cost + EntryCost >= Best)
+            continue;
+        Best = Cost + EntryCost;
+        DirectCell = EntryCell;
+    }
+    // a neighbour of the goal still steps into it, if it is open
+    int DirectCross = DirectCell != GoalCell && IsOpen(GoalCell / m_Cols, GoalCell % m_Cols) ? GoalCell : -1;
+
+    int TargetCell = DirectCell;
+    int TargetNode = -1;
+    for(size_t i = 0; i < StartInfo.m_vNodes.size(); i++)
+    {
+        int Node = StartInfo.m_FirstNode + i;
+        uint16_t Cost = LocalDistance(StartCluster, StartInfo.m_vNodes[i]);
+        if(Cost == UNREACHED || m_vGoalCost[Node] == std::numeric_limits<int>::max() || Cost + m_vGoalCost[Node] >= Best)
+            continue;
+        Best = Cost + m_vGoalCost[Node];
+        TargetCell = StartInfo.m_vNodes[i];
+        TargetNode = Node;
+    }
+    if(TargetCell < 0)
+        return {};
+
+    // skip entrances that only lead along the inside of the start cluster
+    int CrossCell = TargetNode < 0 ? DirectCross : -1;
+    while(TargetNode >= 0 && m_vGoalNext[TargetNode] >= 0)
+    {
+        int NextCell = NodeCell(m_vGoalNext[TargetNode]);
+        if(ClusterOf(NextCell) != StartCluster)
+        {
+            CrossCell = NextCell;
+            break;
+        }
+        TargetNode = m_vGoalNext[TargetNode];
+        TargetCell = NextCell;
+    }
+    if(TargetNode >= 0 && CrossCell < 0)
+    {
+        // the chain ends walking to the goal, which is never cheaper than
+        // walking there directly
+        if(DirectCell < 0)
+            return {};
+        TargetCell = DirectCell;
+        CrossCell = DirectCross;
+    }
+
+    // refine inside the start cluster only, following the same descent
+    // rule as AStar::findPath
+    LocalBfs(StartCluster, TargetCell);
+    int X0 = StartCluster % m_ClustersX * CLUSTER_SIZE;
+    int Y0 = StartCluster / m_ClustersX * CLUSTER_SIZE;
+    int X1 = std::min(X0 + CLUSTER_SIZE, m_Cols);
+    int Y1 = std::min(Y0 + CLUSTER_SIZE, m_Rows);
+
+    std::vector<std::pair<int, int>> ret;
+    static const std::pair<int, int> directions[] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+    int y = StartY;
+    int x = StartX;
+    while((int) ret.size() < MaxLength && y * m_Cols + x != TargetCell)
+    {
+        std::pair<int, int> bestMove = {-1, -1};
+        uint16_t minDistance = UNREACHED;
+        for(const auto& [dy, dx] : directions)
+        {
+            int ny = y + dy;
+            int nx = x + dx;
+            if(ny < Y0 || ny >= Y1 || nx < X0 || nx >= X1 || !IsOpen(ny, nx))
+                continue;
+
+            uint16_t Distance = m_vLocal[(ny - Y0) * CLUSTER_SIZE + nx - X0];
+            if(Distance < minDistance)
+            {
+                minDistance = Distance;
+                bestMove = {dy, dx};
+                if(IsDangerous(ny + 1, nx))
+                    bestMove.first = -1;
+            }
+        }
+
+        if(bestMove == std::pair<int, int>{-1, -1})
+            return ret;
+
+        auto [dy, dx] = bestMove;
+        y += dy;
+        x += dx;
+        ret.push_back(bestMove);
+        if(minDistance == 0)
+            break;
+    }
+
+    // leave the cluster through the entrance
+    if(CrossCell >= 0 && (int) ret.size() < MaxLength && y * m_Cols + x == TargetCell)
+    {
+        int ny = CrossCell / m_Cols;
+        int nx = CrossCell % m_Cols;
+        std::pair<int, int> Move = {ny - y, nx - x};
+        if(IsDangerous(ny + 1, nx))
+            Move.first = -1;
+        ret.push_back(Move);
+    }
+    return ret;
+}
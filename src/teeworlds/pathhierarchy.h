@@ -0,0 +1,93 @@
+#ifndef TEEWORLDS_PATHHIERARCHY_H
+#define TEEWORLDS_PATHHIERARCHY_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "pathgrid.h"
+
+// Two-level view of the tile grid for long-range queries. The map is cut
+// into square clusters, walkable runs across every cluster border become
+// entrances, and the walking distances between the entrances of a cluster
+// are precomputed. The small abstract graph is searched once per goal,
+// and a query then only walks the tiles of the cluster the bot stands in.
+// The grid is shared with the caller, who keeps it up to date.
+class CPathHierarchy
+{
+public:
+    enum
+    {
+        CLUSTER_SIZE = 16,
+    };
+
+    static constexpr uint16_t UNREACHED = 0xffff;
+
+    CPathHierarchy();
+
+    void Build(const CPathGrid& Grid);
+    void Clear();
+    // the grid it was built from moved to another object with the same cells
+    void Rebind(const CPathGrid& Grid) { if(m_pGrid) m_pGrid = &Grid; }
+
+    // Rebuild only the clusters whose entrances or inner distances can
+    // have changed after the given cells of the grid opened or closed.
+    void Update(const std::vector<int>& vFlipped);
+
+    // Same move format as AStar::findPath, towards Goal.
+    std::vector<std::pair<int, int>> FindPath(std::pair<int, int> Start, std::pair<int, int> Goal, int MaxLength = 30);
+
+    bool Built() const { return m_pGrid && m_Rows > 0 && m_Cols > 0; }
+    int NumClusters() const { return m_vClusters.size(); }
+    int NumNodes() const { return m_NumNodes; }
+    int LastRebuilt() const { return m_LastRebuilt; }
+
+private:
+    struct SCluster
+    {
+        std::vector<int> m_vNodes; // entrance cells on this side of the borders
+        std::vector<std::vector<int>> m_vvPartners; // cells across the border, per node
+        std::vector<uint16_t> m_vCost; // node x node walking distance inside the cluster
+        int m_FirstNode; // global id of m_vNodes[0]
+    };
+
+    const CPathGrid *m_pGrid;
+    int m_Rows;
+    int m_Cols;
+    int m_ClustersX;
+    int m_ClustersY;
+    int m_NumNodes;
+    int m_LastRebuilt;
+    std::vector<SCluster> m_vClusters;
+
+    // abstract cost to go of every entrance towards the last queried goal
+    bool m_FieldValid;
+    int m_FieldGoal;
+    std::vector<std::pair<int, int>> m_vGoalEntries; // cells the goal is walked to from, with their cost
+    std::vector<int> m_vGoalCost;
+    std::vector<int> m_vGoalNext; // next entrance on the way, -1 if the goal is walked to
+
+    // scratch space
+    std::vector<int> m_vDirty;
+    std::vector<uint8_t> m_vMarked;
+    std::vector<uint16_t> m_vLocal;
+    std::vector<int> m_vQueue;
+
+    bool IsOpen(int y, int x) const { return m_pGrid->IsOpen(y, x); }
+    bool IsDangerous(int y, int x) const { return m_pGrid->IsDangerous(y, x); }
+    int ClusterOf(int Cell) const { return (Cell / m_Cols / CLUSTER_SIZE) * m_ClustersX + Cell % m_Cols / CLUSTER_SIZE; }
+    int NodeOf(int Cluster, int Cell) const;
+    int ClusterOfNode(int Node) const;
+    int NodeCell(int Node) const;
+
+    void AddBorderEntrances(int Cluster, int Side);
+    void BuildClusterNodes(int Cluster);
+    void BuildClusterCosts(int Cluster);
+    void RebuildDirty();
+    void BuildGoalField(int GoalCell);
+    // walking distances inside Cluster from Cell into m_vLocal
+    void LocalBfs(int Cluster, int Cell);
+    uint16_t LocalDistance(int Cluster, int Cell) const;
+};
+
+#endif // TEEWORLDS_PATHHIERARCHY_H
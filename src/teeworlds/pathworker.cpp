@@ -0,0 +1,284 @@
+#include <include/base.h>
+
+#include <base/storage.h>
+#include <teeworlds/six/math.h>
+
+#include "pathworker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+CPathWorker::CPathWorker() :
+    m_Stop(false), m_Requests(0)
+{
+    m_HasResult = false;
+    m_Incremental = true;
+    m_Backend = CBitWavefront::BACKEND_QUEUE;
+    m_MapHash = 0;
+    m_pFlowFields = nullptr;
+    m_HasLast = false;
+    m_LastKey = {-1, -1, 0};
+    m_Solved = 0;
+    m_HasAnswer = false;
+    ResetStats();
+}
+
+CPathWorker::~CPathWorker()
+{
+    Stop();
+}
+
+void CPathWorker::Start(const CTileLayer& Layer, uint64_t MapHash, CFlowFieldService *pFlowFields, size_t CacheCapacity, bool Incremental, SPathMap& Map)
+{
+    Stop();
+
+    m_Layer = Layer;
+    m_Overlay.Init(Layer.Width(), Layer.Height());
+    m_Map = std::move(Map);
+    m_Map.m_PathHierarchy.Rebind(m_Map.m_PathGrid);
+    m_GridOverlay.Init(Layer.Width(), Layer.Height());
+    m_MapHash = MapHash;
+    m_pFlowFields = pFlowFields;
+    m_Cache.Clear();
+    m_Cache.ResetStats();
+    m_Cache.SetCapacity(CacheCapacity);
+    m_Incremental = Incremental;
+    m_HasLast = false;
+    m_Solved = 0;
+    ResetStats();
+
+    m_Thread = std::thread(&CPathWorker::Run, this);
+}
+
+void CPathWorker::Stop()
+{
+    if(m_Thread.joinable())
+    {
+        m_Stop = true;
+        m_Requests.fetch_add(1);
+        m_Requests.notify_one();
+        m_Thread.join();
+    }
+
+    m_Stop = false;
+    m_Requests = 0;
+    m_Request.Reset();
+    m_Result.Reset();
+    m_HasResult = false;
+    m_Map = SPathMap();
+    m_HasAnswer = false;
+    m_Answered = SPathRequest();
+    m_Answer = SPathResult();
+}
+
+void CPathWorker::Request(const SPathRequest& Request)
+{
+    m_Request.Back() = Request;
+    m_Request.Publish();
+
+    m_Requests.fetch_add(1, std::memory_order_release);
+    m_Requests.notify_one();
+}
+
+SPathResult *CPathWorker::Latest()
+{
+    if(m_Result.Acquire())
+        m_HasResult = true;
+    return m_HasResult ? &m_Result.Front() : nullptr;
+}
+
+void CPathWorker::SampleAge(int Tick)
+{
+    if(!m_HasResult)
+        return;
+
+    int Age = std::max(Tick - m_Result.Front().m_Tick, 0);
+    m_AgeSum += Age;
+    m_AgeSamples++;
+    m_MaxAge = std::max(m_MaxAge, Age);
+}
+
+void CPathWorker::ResetStats()
+{
+    m_AgeSum = 0;
+    m_AgeSamples = 0;
+    m_MaxAge = 0;
+}
+
+void CPathWorker::PickBackend()
+{
+    // which search is faster depends on the CPU and on how open the map is,
+    // so time a few fields of this map with every backend the CPU runs
+    const int NumGoals = 4;
+    int Rows = m_Layer.Height();
+    int Cols = m_Layer.Width();
+    std::vector<int> vNoDanger;
+    AStar Field;
+    double BestTime = 0.0;
+    m_Backend = CBitWavefront::BACKEND_QUEUE;
+    for(int Backend : {(int) CBitWavefront::BACKEND_QUEUE, CBitWavefront::BitBackend()})
+    {
+        Field.setBackend(Backend);
+        Field.build(m_Layer, vNoDanger, {Rows / 2, Cols / 2}); // warm up the buffers
+        auto Start = std::chrono::steady_clock::now();
+        for(int i = 1; i <= NumGoals; i++)
+            Field.build(m_Layer, vNoDanger, {Rows * i / (NumGoals + 1), Cols * i / (NumGoals + 1)});
+        double Time = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+        if(Backend == CBitWavefront::BACKEND_QUEUE || Time < BestTime)
+        {
+            m_Backend = Backend;
+            BestTime = Time;
+        }
+    }
+}
+
+void CPathWorker::Run()
+{
+    PickBackend();
+
+    uint32_t Seen = 0;
+    while(true)
+    {
+        m_Requests.wait(Seen, std::memory_order_acquire);
+        Seen = m_Requests.load(std::memory_order_acquire);
+        if(m_Stop)
+            break;
+
+        // requests that came in while the last field was built were
+        // replaced, only the newest one is answered
+        if(!m_Request.Acquire())
+            continue;
+        Solve(m_Request.Front());
+        m_Result.Back() = m_Answer;
+        m_Result.Publish();
+    }
+}
+
+void CPathWorker::Solve(const SPathRequest& Request)
+{
+    bool First = !m_HasAnswer;
+    m_HasAnswer = true;
+    m_Answer.m_Tick = Request.m_Tick;
+
+    // the routes are searched on the grid with the danger cells applied
+    m_vGridChanges.clear();
+    if(m_GridOverlay.Assign(Request.m_vDangerCells, m_vGridChanges))
+    {
+        CLayeredGrid Grid(m_Layer, m_GridOverlay);
+        m_vFlipped.clear();
+        m_Map.m_PathGrid.Update(m_vGridChanges, [&](int y, int x) { return Grid.GridValue(x, y); }, m_vFlipped);
+        m_Map.m_PathHierarchy.Update(m_vFlipped);
+    }
+
+    // strongholds are where the bots keep going, they make good landmarks
+    bool Grown = false;
+    for(size_t i = m_Answered.m_vLandmarkCells.size(); i < Request.m_vLandmarkCells.size(); i++)
+        Grown |= m_Map.m_Landmarks.AddLandmark(Request.m_vLandmarkCells[i]);
+    if(Grown && m_Map.m_pStorage)
+    {
+        std::vector<char> vData;
+        m_Map.m_Landmarks.Save(vData);
+        if(!m_Map.m_pStorage->TwsWriteMapData(m_Map.m_Map.c_str(), m_Map.m_Crc.c_str(), "alt", vData.data(), vData.size()))
+            log_msg("sugarcane/tws", "failed to save landmark tables");
+    }
+    m_Answer.m_NumLandmarks = m_Map.m_Landmarks.NumLandmarks();
+
+    if(Request.m_Field && (First || !m_Answer.m_pField || !(Request.m_Key == m_Answer.m_Key)))
+    {
+        m_Answer.m_Key = Request.m_Key;
+        m_Answer.m_pField = SolveField(Request);
+        m_Solved++;
+    }
+
+    m_Answer.m_Route = Request.m_Route;
+    m_Answer.m_RouteStart = Request.m_RouteStart;
+    if(Request.m_Route == ROUTE_HIERARCHY)
+        m_Answer.m_vRoute = m_Map.m_PathHierarchy.FindPath(Request.m_RouteStart, Request.m_RouteGoal, ROUTE_LENGTH);
+    else if(Request.m_Route == ROUTE_LANDMARKS)
+        m_Answer.m_vRoute = m_Map.m_Landmarks.FindPath(m_Map.m_PathGrid, Request.m_RouteStart, Request.m_RouteGoal, ROUTE_LENGTH);
+    else
+        m_Answer.m_vRoute.clear();
+
+    if(m_Map.m_Nav && (!m_Map.m_pNavGraph || memcmp(&Request.m_NavTuning, &m_Map.m_NavTuning, sizeof(CTuningParams))))
+    {
+        auto BuildStart = std::chrono::steady_clock::now();
+        CCollision Collision;
+        Collision.Init(&m_Layer, &m_Map.m_Clearance);
+        std::shared_ptr<CNavGraph> pNavGraph = std::make_shared<CNavGraph>();
+        pNavGraph->Build(Collision, Request.m_NavTuning);
+        m_Map.m_pNavGraph = pNavGraph;
+        m_Map.m_NavTuning = Request.m_NavTuning;
+        log_msgf("sugarcane/tws", "navigation graph: {} nodes, {} edges, built in {} ms", pNavGraph->NumNodes(), pNavGraph->NumEdges(), std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - BuildStart).count());
+    }
+    if(m_Answer.m_pNavGraph != m_Map.m_pNavGraph)
+    {
+        // the nodes of the old graph mean nothing in the new one
+        m_Answer.m_NavGraph++;
+        m_Answer.m_pNavGraph = m_Map.m_pNavGraph;
+        m_Answer.m_pNavField = nullptr;
+    }
+
+    int NavGoal = m_Answer.m_pNavField ? m_Answer.m_pNavField->Goal() : -1;
+    if(m_Answer.m_pNavGraph && Request.m_NavGraph == m_Answer.m_NavGraph && Request.m_NavGoal != NavGoal)
+    {
+        std::shared_ptr<CNavField> pNavField;
+        if(Request.m_NavGoal >= 0)
+        {
+            pNavField = std::make_shared<CNavField>();
+            pNavField->Build(*m_Answer.m_pNavGraph, Request.m_NavGoal);
+        }
+        m_Answer.m_pNavField = pNavField;
+    }
+
+    // nearest stronghold by path length, every stronghold seeds the same search
+    if(Request.m_StrongholdSearch != m_Answer.m_StrongholdSearch)
+    {
+        std::shared_ptr<AStar> pStrongholdField = std::make_shared<AStar>();
+        pStrongholdField->build(m_Layer, std::vector<int>(), Request.m_vStrongholds);
+        m_Answer.m_StrongholdSearch = Request.m_StrongholdSearch;
+        m_Answer.m_pStrongholdField = pStrongholdField;
+    }
+
+    m_Answered = Request;
+}
+
+std::shared_ptr<const CFlowField> CPathWorker::SolveField(const SPathRequest& Request)
+{
+    const SFieldKey& Key = Request.m_Key;
+
+    // another bot may be chasing the same goal through the same lasers
+    SFlowKey FlowKey = {m_MapHash, Key.m_GoalY, Key.m_GoalX, SFlowKey::HashCells(Request.m_vDangerCells)};
+    if(std::shared_ptr<const CFlowField> pFlow = m_pFlowFields->Find(FlowKey))
+        return pFlow;
+
+    AStar *pField = nullptr;
+    if(m_Incremental && m_HasLast && !m_Cache.Contains(Key) && m_LastKey.m_GoalY == Key.m_GoalY && m_LastKey.m_GoalX == Key.m_GoalX)
+    {
+        // only the danger cells changed since the last field, repair it in place
+        pField = m_Cache.Rekey(m_LastKey, Key);
+        if(pField)
+        {
+            m_vChanges.clear();
+            m_Overlay.Assign(Request.m_vDangerCells, m_vChanges);
+            CLayeredGrid Grid(m_Layer, m_Overlay);
+            pField->repair(m_vChanges, [&](int y, int x) { return Grid.GridValue(x, y); });
+        }
+    }
+
+    if(!pField)
+    {
+        pField = m_Cache.Get(Key, [&](AStar& Field)
+        {
+            Field.setBackend(m_Backend);
+            Field.build(m_Layer, Request.m_vDangerCells, {Key.m_GoalY, Key.m_GoalX});
+        });
+    }
+
+    m_HasLast = true;
+    m_LastKey = Key;
+    m_vChanges.clear();
+    m_Overlay.Assign(Request.m_vDangerCells, m_vChanges); // nothing left to do after a repair
+
+    return m_pFlowFields->Acquire(FlowKey, [pField](CFlowField& Flow) { Flow.Build(*pField); });
+}
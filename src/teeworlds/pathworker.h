@@ -0,0 +1,210 @@
+#ifndef TEEWORLDS_PATHWORKER_H
+#define TEEWORLDS_PATHWORKER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "astar.h"
+#include "fieldcache.h"
+#include "flowfield.h"
+#include "landmarks.h"
+#include "map/clearance.h"
+#include "map/overlay.h"
+#include "navgraph.h"
+#include "pathgrid.h"
+#include "pathhierarchy.h"
+
+class IStorage;
+
+// Hands the newest value of one writer thread to one reader thread without
+// either of them waiting. The writer fills the back slot and the reader
+// keeps the front slot; publishing swaps the back slot with the spare one,
+// and the reader swaps the spare one in when it holds something newer.
+template<typename T>
+class CTripleBuffer
+{
+    enum
+    {
+        SLOT_MASK = 3,
+        FRESH = 4,
+    };
+
+    T m_aSlots[3];
+    std::atomic<uint8_t> m_Spare;
+    uint8_t m_Back;
+    uint8_t m_Front;
+
+public:
+    CTripleBuffer()
+    {
+        Reset();
+    }
+
+    // only while neither side is using it
+    void Reset()
+    {
+        for(T& Slot : m_aSlots)
+            Slot = T();
+        m_Back = 0;
+        m_Spare = 1;
+        m_Front = 2;
+    }
+
+    // writer side
+    T& Back() { return m_aSlots[m_Back]; }
+    void Publish() { m_Back = m_Spare.exchange(m_Back | FRESH, std::memory_order_acq_rel) & SLOT_MASK; }
+
+    // reader side, false if nothing was published since the last call
+    bool Acquire()
+    {
+        if(!(m_Spare.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        m_Front = m_Spare.exchange(m_Front, std::memory_order_acq_rel) & SLOT_MASK;
+        return true;
+    }
+    T& Front() { return m_aSlots[m_Front]; }
+};
+
+// The searches of a map besides the distance fields, moved to the worker
+// by Start and only touched by it from then on.
+struct SPathMap
+{
+    CPathGrid m_PathGrid;
+    CPathHierarchy m_PathHierarchy; // rebound to m_PathGrid by Start
+    CLandmarks m_Landmarks;
+    // The navigation graph is simulated again whenever a request brings
+    // other tuning than the graph was built with, the server only sends
+    // its tuning after the map was loaded.
+    bool m_Nav = false;
+    std::shared_ptr<const CNavGraph> m_pNavGraph; // built from the first request if null
+    CTuningParams m_NavTuning;
+    CClearanceField m_Clearance;
+    // landmark tables grown by strongholds are saved as <crc>.alt
+    IStorage *m_pStorage = nullptr;
+    std::string m_Map;
+    std::string m_Crc;
+};
+
+enum
+{
+    ROUTE_NONE = 0,
+    ROUTE_HIERARCHY,
+    ROUTE_LANDMARKS,
+};
+
+// Everything the network thread wants searched at once. Parts that are the
+// same as in the request answered before are not searched again.
+struct SPathRequest
+{
+    int m_Tick = 0;
+    std::vector<int> m_vDangerCells; // sorted
+    bool m_Field = false; // a distance field towards m_Key
+    SFieldKey m_Key = {-1, -1, 0};
+    int m_Route = ROUTE_NONE; // point to point from m_RouteStart, ROUTE_*
+    std::pair<int, int> m_RouteStart = {-1, -1};
+    std::pair<int, int> m_RouteGoal = {-1, -1};
+    CTuningParams m_NavTuning;
+    int m_NavGraph = 0; // the graph of the result m_NavGoal is a node of
+    int m_NavGoal = -1;
+    int m_StrongholdSearch = 0; // bumped for every search of m_vStrongholds
+    std::vector<std::pair<int, int>> m_vStrongholds;
+    std::vector<int> m_vLandmarkCells; // cells to add as landmarks, only grows
+};
+
+struct SPathResult
+{
+    int m_Tick = 0; // game tick of the request the result answers
+    SFieldKey m_Key = {-1, -1, 0};
+    std::shared_ptr<const CFlowField> m_pField;
+    int m_Route = ROUTE_NONE;
+    std::pair<int, int> m_RouteStart = {-1, -1};
+    std::vector<std::pair<int, int>> m_vRoute; // same move format as AStar::findPath
+    int m_NavGraph = 0; // bumped for every graph, 0 for none
+    std::shared_ptr<const CNavGraph> m_pNavGraph;
+    std::shared_ptr<const CNavField> m_pNavField; // on m_pNavGraph
+    int m_StrongholdSearch = 0;
+    std::shared_ptr<const AStar> m_pStrongholdField; // goalOf indexes the searched strongholds
+    int m_NumLandmarks = 0;
+};
+
+// Runs the path searches on a thread of its own, so a slow query never
+// holds up the input of the network thread. The network thread posts what
+// it wants and keeps steering by the newest finished answers in the
+// meantime. The field cache and the incremental repairs live on the
+// worker, which hands out flow fields shared with the other bots, and so
+// do the grid, hierarchy and landmarks the point to point routes are
+// searched on.
+class CPathWorker
+{
+public:
+    static constexpr int ROUTE_LENGTH = 20; // moves of a point to point route
+
+    CPathWorker();
+    ~CPathWorker();
+
+    // (Re)starts the worker on a new map, Map is moved from.
+    void Start(const CTileLayer& Layer, uint64_t MapHash, CFlowFieldService *pFlowFields, size_t CacheCapacity, bool Incremental, SPathMap& Map);
+    void Stop();
+
+    // Network thread only. A newer request replaces one not yet picked up.
+    void Request(const SPathRequest& Request);
+    // The newest result, nullptr until the first one is done. It stays
+    // valid until the next call.
+    SPathResult *Latest();
+
+    // How many ticks behind Tick the newest field is, added to the stats.
+    void SampleAge(int Tick);
+    void ResetStats();
+    uint64_t Solved() const { return m_Solved; }
+    double MeanAge() const { return m_AgeSamples ? (double) m_AgeSum / m_AgeSamples : 0.0; }
+    int MaxAge() const { return m_MaxAge; }
+
+    // only while stopped
+    const CDistanceFieldCache& Cache() const { return m_Cache; }
+    int Backend() const { return m_Backend; }
+
+private:
+    std::thread m_Thread;
+    std::atomic<bool> m_Stop;
+    std::atomic<uint32_t> m_Requests; // bumped for every request, the worker sleeps on it
+    CTripleBuffer<SPathRequest> m_Request;
+    CTripleBuffer<SPathResult> m_Result;
+
+    // network thread
+    bool m_HasResult;
+    uint64_t m_AgeSum;
+    uint64_t m_AgeSamples;
+    int m_MaxAge;
+
+    // worker thread
+    CTileLayer m_Layer;
+    SPathMap m_Map;
+    uint64_t m_MapHash;
+    CFlowFieldService *m_pFlowFields;
+    CDistanceFieldCache m_Cache;
+    bool m_Incremental;
+    int m_Backend; // CBitWavefront::BACKEND_*, picked per map
+    bool m_HasLast;
+    SFieldKey m_LastKey;
+    CDangerOverlay m_Overlay; // danger cells of the last field
+    std::vector<int> m_vChanges;
+    std::atomic<uint64_t> m_Solved;
+    CDangerOverlay m_GridOverlay; // danger cells applied to the path grid
+    std::vector<int> m_vGridChanges;
+    std::vector<int> m_vFlipped;
+    bool m_HasAnswer;
+    SPathRequest m_Answered; // the request the answer is for
+    SPathResult m_Answer;
+
+    void Run();
+    void PickBackend();
+    void Solve(const SPathRequest& Request);
+    std::shared_ptr<const CFlowField> SolveField(const SPathRequest& Request);
+};
+
+#endif // TEEWORLDS_PATHWORKER_H
@@ -3,6 +3,7 @@
 #include "compression.h"
 #include "mastersrv.h"
 #include "main.h"
+#include "math.h"
 
 #include <base/sugarcane.h>
 
@@ -114,6 +115,8 @@ CClient::CClient() : IClient()
 	m_aCurrentMap[0] = 0;
 	m_CurrentMapCrc = 0;
 
+	m_MapDownloadWindow = MAP_DOWNLOAD_WINDOW;
+
 	//
 	m_aCmdConnect[0] = 0;
 
@@ -192,6 +195,79 @@ void CClient::SendReady()
 	SendMsgEx(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
 }
 
+void CClient::StartMapDownload(const char *pMap, int MapCrc, int MapSize)
+{
+	str_copy(m_aMapDownloadName, pMap, sizeof(m_aMapDownloadName));
+	m_MapDownloadCrc = MapCrc;
+	m_MapDownloadSize = MapSize;
+	m_MapDownloadChunk = 0;
+	m_MapDownloadRequested = 0;
+	m_MapDownloadNumChunks = -1;
+	m_vMapDownloadData.clear();
+	if(MapSize > 0 && MapSize <= 64*1024*1024) // sane sizes only, the vector grows anyway
+		m_vMapDownloadData.reserve(MapSize);
+	m_MapDownloadStartTime = time_get();
+	mem_zero(m_aMapDownloadSlotSize, sizeof(m_aMapDownloadSlotSize));
+	RequestMapData();
+}
+
+void CClient::RequestMapData()
+{
+	// The first chunk tells the chunk size and with it the number of chunks,
+	// the window only opens once no request can go past the end of the map.
+	// A map size the chunks disagree with is finished one chunk at a time.
+	int Window = m_MapDownloadNumChunks < 0 ? 1 : m_MapDownloadWindow;
+	int End = m_MapDownloadChunk + Window;
+	if(m_MapDownloadNumChunks >= 0)
+		End = min(End, max(m_MapDownloadNumChunks, m_MapDownloadChunk + 1));
+
+	while(m_MapDownloadRequested < End)
+	{
+		CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA);
+		Msg.AddInt(m_MapDownloadRequested);
+		m_MapDownloadRequested++;
+		SendMsgEx(&Msg, MSGFLAG_VITAL|(m_MapDownloadRequested == End ? MSGFLAG_FLUSH : 0));
+	}
+}
+
+bool CClient::StoreMapData(int Chunk, bool Last, const unsigned char *pData, int Size)
+{
+	// only chunks that were asked for and not stored yet
+	if(Chunk < m_MapDownloadChunk || Chunk >= m_MapDownloadRequested || Size > NET_MAX_PAYLOAD)
+		return false;
+	int Slot = Chunk % MAX_MAP_DOWNLOAD_WINDOW;
+	if(m_aMapDownloadSlotSize[Slot])
+		return false;
+	mem_copy(m_aaMapDownloadSlots[Slot], pData, Size);
+	m_aMapDownloadSlotSize[Slot] = Size;
+	m_aMapDownloadSlotLast[Slot] = Last;
+	if(m_MapDownloadNumChunks < 0 && !Last && Chunk == 0 && m_MapDownloadSize > 0)
+		m_MapDownloadNumChunks = (m_MapDownloadSize + Size - 1) / Size;
+
+	// append every chunk that is next in line
+	for(Slot = m_MapDownloadChunk % MAX_MAP_DOWNLOAD_WINDOW; m_aMapDownloadSlotSize[Slot]; Slot = m_MapDownloadChunk % MAX_MAP_DOWNLOAD_WINDOW)
+	{
+		m_vMapDownloadData.insert(m_vMapDownloadData.end(), m_aaMapDownloadSlots[Slot], m_aaMapDownloadSlots[Slot] + m_aMapDownloadSlotSize[Slot]);
+		m_aMapDownloadSlotSize[Slot] = 0;
+		m_MapDownloadChunk++;
+		if(m_aMapDownloadSlotLast[Slot])
+		{
+			// nothing after the last chunk is wanted anymore
+			m_MapDownloadRequested = m_MapDownloadChunk;
+			mem_zero(m_aMapDownloadSlotSize, sizeof(m_aMapDownloadSlotSize));
+			return true;
+		}
+	}
+
+	RequestMapData();
+	return false;
+}
+
+void CClient::SetMapDownloadWindow(int Window)
+{
+	m_MapDownloadWindow = clamp(Window, 1, (int) MAX_MAP_DOWNLOAD_WINDOW);
+}
+
 void CClient::Rcon(const char *pCmd)
 {
 	CMsgPacker Msg(NETMSG_RCON_CMD);
@@ -432,27 +508,27 @@ void CClient::ProcessServerPacket(CNetChunk *pPacket)
 				DisconnectWithReason(pError);
 			else
 			{
+				bool Loaded = false;
 				if(m_pSugarcane->CheckMap(pMap, MapCrc))
 				{
-					if(!m_pSugarcane->LoadMap(pMap, MapCrc))
+					Loaded = m_pSugarcane->LoadMap(pMap, MapCrc);
+					// a stored map that fails to load is dropped and downloaded
+					if(!Loaded && m_pSugarcane->CheckMap(pMap, MapCrc))
 					{
 						Disconnect();
 						return;
 					}
+				}
 
+				if(Loaded)
+				{
 					log_msg("client/network", "loading done");
 					SendReady();
 				}
 				else
 				{
-					str_copy(m_aMapDownloadName, pMap, sizeof(m_aMapDownloadName));
-					m_MapDownloadCrc = MapCrc;
-					m_MapDownloadChunk = 0;
-
-					CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA);
-					Msg.AddInt(m_MapDownloadChunk);
-					SendMsgEx(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
-					log_msg("client/network", "start downloading map");
+					StartMapDownload(pMap, MapCrc, MapSize);
+					log_msgf("client/network", "start downloading map, {} bytes with up to {} chunks in flight", MapSize, m_MapDownloadWindow);
 				}
 			}
 		}
@@ -465,33 +541,33 @@ void CClient::ProcessServerPacket(CNetChunk *pPacket)
 			const unsigned char *pData = Unpacker.GetRaw(Size);
 
 			// check fior errors
-			if(Unpacker.Error() || Size <= 0 || MapCrc != m_MapDownloadCrc || Chunk != m_MapDownloadChunk)
+			if(Unpacker.Error() || Size <= 0 || MapCrc != m_MapDownloadCrc)
 				return;
 
-			if(!m_pSugarcane->DownloadMap(m_aMapDownloadName, m_MapDownloadCrc, (void *) pData, Size))
+			// true once the last chunk is stored, requests the next ones otherwise
+			if(!StoreMapData(Chunk, Last != 0, pData, Size))
 				return;
 
-			if(Last)
-			{
-				log_msg("client/network", "download complete, loading map");
-				if(!m_pSugarcane->LoadMap(m_aMapDownloadName, MapCrc))
-				{
-					Disconnect();
-					return;
-				}
+			int Stored = (int) m_vMapDownloadData.size();
+			float Seconds = (time_get() - m_MapDownloadStartTime) / (float) time_freq();
+			log_msgf("client/network", "download complete, {} bytes in {} chunks, {:.2f}s, {:.1f} KiB/s, loading map", Stored, m_MapDownloadChunk, Seconds, Stored / 1024.0f / max(Seconds, 0.001f));
 
-				log_msg("client/network", "loading done");
-				SendReady();
+			// checked and stored as a whole, then loaded from memory
+			std::vector<unsigned char> vMap;
+			vMap.swap(m_vMapDownloadData);
+			if(!m_pSugarcane->DownloadMap(m_aMapDownloadName, MapCrc, vMap.data(), Stored))
+			{
+				DisconnectWithReason("downloaded map is broken");
+				return;
 			}
-			else
+			if(!m_pSugarcane->LoadMap(m_aMapDownloadName, MapCrc, vMap.data(), Stored))
 			{
-				// request new chunk
-				m_MapDownloadChunk++;
-
-				CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA);
-				Msg.AddInt(m_MapDownloadChunk);
-				SendMsgEx(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+				Disconnect();
+				return;
 			}
+
+			log_msg("client/network", "loading done");
+			SendReady();
 		}
 		else if((pPacket->m_Flags&NET_CHUNKFLAG_VITAL) != 0 && Msg == NETMSG_CON_READY)
 		{
@@ -721,6 +797,7 @@ void CClient::ProcessServerPacket(CNetChunk *pPacket)
 
 				// apply new tuning
 				m_Tuning = NewTuning;
+				m_pSugarcane->TuningChanged();
 				return;
 			}
 
@@ -934,6 +1011,8 @@ void CClient::OnNewSnapshot()
 
 		m_pSugarcane->OnNewSnapshot(&Item, pData);
 	}
+
+	m_pSugarcane->EndSnap();
 }
 
 void CClient::SetSugarcane(ISugarcane *pSugarcane)
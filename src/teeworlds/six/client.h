@@ -12,6 +12,8 @@
 #include "snapshot.h"
 #include "tune.h"
 
+#include <vector>
+
 class CSmoothTime
 {
 	int64 m_Snap;
@@ -42,15 +44,29 @@ class CClient : public IClient
 	{
 		NUM_SNAPSHOT_TYPES=2,
 		PREDICTION_MARGIN=1000/50/2, // magic network prediction value
+		MAP_DOWNLOAD_WINDOW=8,
+		MAX_MAP_DOWNLOAD_WINDOW=16, // vanilla servers answer every request, keep the burst small
 	};
 
 	class CNetClient m_NetClient[2];
 	
 	char m_aServerAddressStr[256];
 
+	// map download, up to m_MapDownloadWindow chunks are requested ahead of
+	// the next one to store. Chunks arriving early wait in their slot, the
+	// map is kept in memory until it is complete.
 	char m_aMapDownloadName[256];
 	int m_MapDownloadCrc;
-	int m_MapDownloadChunk;
+	int m_MapDownloadSize;
+	int m_MapDownloadChunk; // next chunk to store
+	int m_MapDownloadRequested; // next chunk to request
+	int m_MapDownloadNumChunks; // known once a chunk tells the chunk size
+	int m_MapDownloadWindow;
+	std::vector<unsigned char> m_vMapDownloadData;
+	int64 m_MapDownloadStartTime;
+	int m_aMapDownloadSlotSize[MAX_MAP_DOWNLOAD_WINDOW]; // 0 for an empty slot
+	bool m_aMapDownloadSlotLast[MAX_MAP_DOWNLOAD_WINDOW];
+	unsigned char m_aaMapDownloadSlots[MAX_MAP_DOWNLOAD_WINDOW][NET_MAX_PAYLOAD];
 
 	unsigned m_SnapshotParts;
 	int64 m_LocalStartTime;
@@ -121,6 +137,9 @@ public:
 	void SendEnterGame();
 	void SendReady();
 	void SendInput();
+	void RequestMapData();
+	void StartMapDownload(const char *pMap, int MapCrc, int MapSize);
+	bool StoreMapData(int Chunk, bool Last, const unsigned char *pData, int Size);
 
 	// ------ state handling -----
 	void SetState(int s);
@@ -156,6 +175,7 @@ public:
 	void Rcon(const char *pCmd);
 
 	void SetSugarcane(class ISugarcane *pSugarcane);
+	void SetMapDownloadWindow(int Window);
 
 	void NeedDisconnect();
 };
@@ -0,0 +1,48 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef TEEWORLDS_SIX_GAMECORE_H
+#define TEEWORLDS_SIX_GAMECORE_H
+
+#include <math.h>
+
+template<typename T, typename T2>
+inline T SaturatedAdd(T2 Min, T2 Max, T Current, T2 Modifier)
+{
+	if(Modifier < 0)
+	{
+		if(Current < Min)
+			return Current;
+		Current += Modifier;
+		if(Current < Min)
+			Current = Min;
+		return Current;
+	}
+	else
+	{
+		if(Current > Max)
+			return Current;
+		Current += Modifier;
+		if(Current > Max)
+			Current = Max;
+		return Current;
+	}
+}
+
+inline float VelocityRamp(float Value, float Start, float Range, float Curvature)
+{
+	if(Value < Start)
+		return 1.0f;
+	return 1.0f/powf(Curvature, (Value-Start)/Range);
+}
+
+enum
+{
+	HOOK_RETRACTED=-1,
+	HOOK_IDLE=0,
+	HOOK_RETRACT_START=1,
+	HOOK_RETRACT_END=3,
+	HOOK_FLYING,
+	HOOK_GRABBED,
+};
+
+#endif // TEEWORLDS_SIX_GAMECORE_H
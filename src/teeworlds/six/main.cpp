@@ -48,7 +48,7 @@ namespace DDNet
 		return new(pClient) CClient;
 	}
 
-	void ConnectTo(string Address, ISugarcane *pSugarcane)
+	void ConnectTo(string Address, ISugarcane *pSugarcane, int MapDownloadWindow)
 	{
 		if(secure_random_init() != 0)
 		{
@@ -58,6 +58,7 @@ namespace DDNet
 
 		CClient *pClient = CreateClient();
 		pClient->SetSugarcane(pSugarcane);
+		pClient->SetMapDownloadWindow(MapDownloadWindow);
 
 		IKernel *pKernel = IKernel::Create();
 		pKernel->RegisterInterface(pClient);
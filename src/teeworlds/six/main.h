@@ -11,7 +11,8 @@ bool IntsToStr(const int *pInts, size_t NumInts, char *pStr, size_t StrSize);
 
 namespace DDNet
 {
-    void ConnectTo(string Address, ISugarcane *pSugarcane);
+    // MapDownloadWindow is the number of map chunks requested at once
+    void ConnectTo(string Address, ISugarcane *pSugarcane, int MapDownloadWindow);
     void Disconnect();
 
     extern CClient *s_pClient;
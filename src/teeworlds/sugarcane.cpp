@@ -1,10 +1,14 @@
 #include <include/base.h>
 
+#include <teeworlds/map/collision.h>
 #include <teeworlds/map/convert.h>
+#include <teeworlds/map/overlay.h>
+#include <teeworlds/map/raster.h>
 
 #include <teeworlds/six/main.h>
 #include <teeworlds/six/generated_protocol.h>
 #include <teeworlds/six/client.h>
+#include <teeworlds/six/gamecore.h>
 #include <teeworlds/six/math.h>
 #include <teeworlds/six/vmath.h>
 
@@ -15,52 +19,25 @@
 #include <cmath>
 #include <chrono>
 
-#include "astar.h"
-
-template<typename T, typename T2>
-inline T SaturatedAdd(T2 Min, T2 Max, T Current, T2 Modifier)
-{
-	if(Modifier < 0)
-	{
-		if(Current < Min)
-			return Current;
-		Current += Modifier;
-		if(Current < Min)
-			Current = Min;
-		return Current;
-	}
-	else
-	{
-		if(Current > Max)
-			return Current;
-		Current += Modifier;
-		if(Current > Max)
-			Current = Max;
-		return Current;
-	}
-}
+#include <zlib.h>
 
-float VelocityRamp(float Value, float Start, float Range, float Curvature)
-{
-	if(Value < Start)
-		return 1.0f;
-	return 1.0f/powf(Curvature, (Value-Start)/Range);
-}
-
-struct SCharacter
+#include "astar.h"
+#include "fieldcache.h"
+#include "flowfield.h"
+#include "landmarks.h"
+#include "mapwarmup.h"
+#include "navgraph.h"
+#include "pathgrid.h"
+#include "pathhierarchy.h"
+#include "pathworker.h"
+#include "worldsim.h"
+
+struct SCharacter : SCharacterCore
 {
     int64_t m_LastSnapshotTick;
     int64_t m_Tick;
-    vec2 m_Pos;
-    vec2 m_Vel;
-    vec2 m_HookPos;
-    vec2 m_HookDir;
+    SCharacterCore m_Reckoning; // as the server sent it, from m_LastSnapshotTick
 	int m_Angle;
-	int m_Direction;
-	int m_Jumped;
-	int m_HookedPlayer;
-	int m_HookState;
-	int m_HookTick;
 	int m_PlayerFlags;
 	int m_Health;
 	int m_Armor;
@@ -69,8 +46,6 @@ struct SCharacter
 	int m_Emote;
 	int m_AttackTick;
 
-    void Prediction();
-
     SCharacter& operator=(const CNetObj_Character& Source)
     {
         m_Pos = vec2((float) Source.m_X, (float) Source.m_Y);
@@ -99,17 +74,18 @@ struct SMapDetail
 {
     std::vector<vec2> m_vStrongholds;
 
-    void SaveStronghold(vec2 NewStronghold)
+    bool SaveStronghold(vec2 NewStronghold)
     {
         for(auto& Stronghold : m_vStrongholds)
         {
             float Distance = distance(Stronghold, NewStronghold);
             if(Distance < 480.f)
             {
-                return;
+                return false;
             }
         }
         m_vStrongholds.push_back(NewStronghold);
+        return true;
     }
 
     void FindNearestStronghold(vec2 Pos, vec2** pFindPos)
@@ -175,17 +151,20 @@ struct SLaser
     }
 };
 
-enum
+static SClient s_aClients[MAX_CLIENTS];
+static std::vector<int> s_vSnapCharacters; // characters of this snapshot, predicted to the game tick in EndSnap
+static CWorldSim s_WorldSim;
+static const CTuningParams s_ReckoningTuning; // the server reckons in a world of its own, with the default tuning
+
+struct SReckoningCheck
 {
-	HOOK_RETRACTED=-1,
-	HOOK_IDLE=0,
-	HOOK_RETRACT_START=1,
-	HOOK_RETRACT_END=3,
-	HOOK_FLYING,
-	HOOK_GRABBED,
+    int m_ClientID;
+    int64_t m_FromTick;
+    SCharacterCore m_From;
 };
-
-static SClient s_aClients[MAX_CLIENTS];
+static std::vector<SReckoningCheck> s_vReckoningChecks;
+static int s_NumReckoningChecks;
+static int s_NumReckoningMisses;
 static std::vector<SLaser> s_vLasers;
 static SMapDetail s_MapDetail;
 
@@ -202,13 +181,50 @@ static SClient *s_pMoveTarget;
 static SClient *s_pTarget;
 constexpr float g_MaxMouseMoveSpeedPerTick = 40.0f;
 constexpr float g_MinMouseMoveSpeedPerTick = 8.0f;
-
-static std::vector<std::vector<int>> s_MapGrid;
-static std::vector<std::vector<int>> s_MapGridWithEntity;
-static ESMapItems *s_pMap;
-static AStar *s_pAStar;
+constexpr size_t g_FieldCacheBudget = 16 * 1024 * 1024;
+constexpr bool g_IncrementalPathing = true;
+constexpr int g_GoalSlack = 2; // tiles the goal may drift before the field is rebuilt
+constexpr int g_GoalSlackRange = 12; // ...as long as the bot is at least this many tiles away
+constexpr bool g_HierarchicalPathing = true;
+constexpr int g_HierarchyRange = 48; // goals further away than this many tiles are searched hierarchically
+constexpr bool g_LandmarkPathing = true; // moving targets are searched point to point instead of by field
+constexpr bool g_NavPathing = true;
+constexpr int g_NavGoalDrop = 8; // tiles below the goal searched for a standable one
+constexpr int g_NavActionSlack = 10; // ticks a maneuver may overrun its simulated duration
+constexpr int g_LaserMargin = 0; // tiles around a laser the paths keep clear of
+constexpr int g_WarmupMaps = 3; // maps last played on the server prepared at startup, 0 turns the warm-up off
+constexpr int g_WarmupThreads = 2;
+constexpr int g_ReckoningTicks = SERVER_TICK_SPEED * 3 + 1; // the server resends a character this long after it last did
+
+static CTileLayer s_TileLayer;
+static CClearanceField s_Clearance;
+static CCollision s_Collision;
+static CFlowFieldService s_FlowFields; // before the worker, it outlives the fields the worker holds
+static CPathWorker s_PathWorker;
+static SPathRequest s_PathRequest; // the last request posted to the worker
+static SPathResult *s_pPathResult; // newest result of the worker
+static const CFlowField *s_pFlowField; // newest field of the worker
+static int s_LastAgeTick;
+static int s_StrongholdSearch; // the stronghold search the worker is still on, 0 for none
+static std::vector<int> s_vDangerCells;
+static CDangerOverlay s_DangerOverlay;
+static std::vector<int> s_vDangerChanges;
+static SFieldKey s_FieldKey;
+static bool s_HierarchyBuilt;
+static bool s_UseHierarchy;
+static int s_NumLandmarks;
+static bool s_UseLandmarks;
+static const CNavGraph *s_pNavGraph; // newest navigation graph of the worker
+static const CNavField *s_pNavField; // ...and the field on it
+static SNavAction s_NavAction;
+static int s_NavActionTo = -1;
+static int64_t s_NavActionStartTick; // game tick the maneuver started on
 static int s_MapWidth;
 static int s_MapHeight;
+static std::string s_MapName;
+static std::string s_MapCrc;
+static std::string s_Server;
+static CMapWarmup s_MapWarmup;
 
 static CNetObj_PlayerInput s_LastInput = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 static CNetObj_PlayerInput s_TickInput = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
@@ -245,391 +261,69 @@ static bool IsOtherTeam(int ClientID)
     return IsInfectClass(s_LocalID) != IsInfectClass(ClientID);
 }
 
-static ESMapItems GetTile(float X, float Y)
+// the tile the grid paths of a tee at Pos start from
+static std::pair<int, int> PathStart(vec2 Pos)
 {
-    int MapX = clamp(round_to_int(X) / 32, 0, s_MapWidth);
-    int MapY = clamp(round_to_int(Y) / 32, 0, s_MapHeight);
-    return s_pMap[MapY * s_MapWidth + MapX];
-}
-
-static bool CheckPoint(float X, float Y, ESMapItems Flag = ESMapItems::TILEFLAG_SOLID)
-{
-    return GetTile(X, Y) & Flag;
-}
-
-static bool CheckPoint(vec2 Pos, ESMapItems Flag = ESMapItems::TILEFLAG_SOLID)
-{
-    return GetTile(Pos.x, Pos.y) & Flag;
+    const int PhysSize = 28;
+    return {Pos.y / 32, (Pos.x + PhysSize / 2) / 32};
 }
 
-static bool IsGrounded(float X, float Y)
+// The moves of the worker's newest route from Start on. The route was
+// searched from where the bot stood when it asked, it is followed from
+// wherever the bot got to along it since.
+static std::vector<std::pair<int, int>> RouteFrom(std::pair<int, int> Start)
 {
-    return CheckPoint(X + 14.f, Y + 19.f) || CheckPoint(X - 14.f, Y + 19.f);
-}
+    if(!s_pPathResult || s_pPathResult->m_Route != s_PathRequest.m_Route)
+        return {};
 
-static bool IsGrounded(vec2 Pos)
-{
-    return IsGrounded(Pos.x, Pos.y);
+    const std::vector<std::pair<int, int>>& vRoute = s_pPathResult->m_vRoute;
+    std::pair<int, int> Cell = s_pPathResult->m_RouteStart;
+    for(size_t i = 0; i < vRoute.size(); i++)
+    {
+        if(Cell == Start)
+            return std::vector<std::pair<int, int>>(vRoute.begin() + i, vRoute.end());
+        Cell.first += vRoute[i].first;
+        Cell.second += vRoute[i].second;
+    }
+    return {};
 }
 
-static ESMapItems IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+// heads for the stronghold Goal, or the nearest one as the crow flies if
+// no path reaches any
+static void HeadForStronghold(vec2 NowPos, int Goal)
 {
-    float Distance = distance(Pos0, Pos1);
-    int End(Distance+1);
-    vec2 Last = Pos0;
-
-    for(int i = 0; i < End; i++)
+    vec2 *pFindPos = nullptr;
+    if(Goal >= 0 && Goal < (int) s_MapDetail.m_vStrongholds.size())
+        pFindPos = &s_MapDetail.m_vStrongholds[Goal];
+    if(!pFindPos)
+        s_MapDetail.FindNearestStronghold(NowPos, &pFindPos);
+    if(pFindPos && distance(*pFindPos, NowPos) > 480.0f)
     {
-        float a = i/Distance;
-        vec2 Pos = mix(Pos0, Pos1, a);
-        if(CheckPoint(Pos.x, Pos.y))
-        {
-            if(pOutCollision)
-                *pOutCollision = Pos;
-            if(pOutBeforeCollision)
-                *pOutBeforeCollision = Last;
-            return GetTile(Pos.x, Pos.y);
-        }
-        Last = Pos;
+        s_FindStronghold = true;
+        s_StrongholdPos = *pFindPos;
+        s_pMoveTarget = nullptr;
     }
-    if(pOutCollision)
-        *pOutCollision = Pos1;
-    if(pOutBeforeCollision)
-        *pOutBeforeCollision = Pos1;
-    return ESMapItems::TILEFLAG_AIR;
 }
 
-static bool TestBox(vec2 Pos, vec2 Size)
+static bool CheckPoint(float X, float Y, ESMapItems Flag = ESMapItems::TILEFLAG_SOLID)
 {
-    Size *= 0.5f;
-    if(CheckPoint(Pos.x-Size.x, Pos.y-Size.y))
-        return true;
-    if(CheckPoint(Pos.x+Size.x, Pos.y-Size.y))
-        return true;
-    if(CheckPoint(Pos.x-Size.x, Pos.y+Size.y))
-        return true;
-    if(CheckPoint(Pos.x+Size.x, Pos.y+Size.y))
-        return true;
-    return false;
+    return s_Collision.CheckPoint(X, Y, Flag);
 }
 
-static void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity)
+static bool CheckPoint(vec2 Pos, ESMapItems Flag = ESMapItems::TILEFLAG_SOLID)
 {
-    // do the move
-    vec2 Pos = *pInoutPos;
-    vec2 Vel = *pInoutVel;
-
-    float Distance = length(Vel);
-    int Max = (int)Distance;
-
-    if(Distance > 0.00001f)
-    {
-        //vec2 old_pos = pos;
-        float Fraction = 1.0f/(float)(Max+1);
-        for(int i = 0; i <= Max; i++)
-        {
-            //float amount = i/(float)max;
-            //if(max == 0)
-                //amount = 0;
-
-            vec2 NewPos = Pos + Vel*Fraction; // TODO: this row is not nice
-
-            if(TestBox(vec2(NewPos.x, NewPos.y), Size))
-            {
-                int Hits = 0;
-
-                if(TestBox(vec2(Pos.x, NewPos.y), Size))
-                {
-                    NewPos.y = Pos.y;
-                    Vel.y *= -Elasticity;
-                    Hits++;
-                }
-
-                if(TestBox(vec2(NewPos.x, Pos.y), Size))
-                {
-                    NewPos.x = Pos.x;
-                    Vel.x *= -Elasticity;
-                    Hits++;
-                }
-
-                // neither of the tests got a collision.
-                // this is a real _corner case_!
-                if(Hits == 0)
-                {
-                    NewPos.y = Pos.y;
-                    Vel.y *= -Elasticity;
-                    NewPos.x = Pos.x;
-                    Vel.x *= -Elasticity;
-                }
-            }
-
-            Pos = NewPos;
-        }
-    }
-
-    *pInoutPos = Pos;
-    *pInoutVel = Vel;
+    return s_Collision.CheckPoint(Pos, Flag);
 }
 
-void SCharacter::Prediction()
+static ESMapItems IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
 {
-    float PhysSize = 28.0f;// get ground state
-	bool Grounded = false;
-	if(CheckPoint(m_Pos.x+PhysSize/2, m_Pos.y+PhysSize/2+5))
-		Grounded = true;
-	if(CheckPoint(m_Pos.x-PhysSize/2, m_Pos.y+PhysSize/2+5))
-		Grounded = true;
-
-    CTuningParams *pTuning = DDNet::s_pClient->Tuning();
-	m_Vel.y += pTuning->m_Gravity;
-
-	float MaxSpeed = Grounded ? pTuning->m_GroundControlSpeed : pTuning->m_AirControlSpeed;
-	float Accel = Grounded ? pTuning->m_GroundControlAccel : pTuning->m_AirControlAccel;
-	float Friction = Grounded ? pTuning->m_GroundFriction : pTuning->m_AirFriction;
-
-	// add the speed modification according to players wanted direction
-	if(m_Direction < 0)
-		m_Vel.x = SaturatedAdd(-MaxSpeed, MaxSpeed, m_Vel.x, -Accel);
-	if(m_Direction > 0)
-		m_Vel.x = SaturatedAdd(-MaxSpeed, MaxSpeed, m_Vel.x, Accel);
-	if(m_Direction == 0)
-		m_Vel.x *= Friction;
-
-	// handle jumping
-	// 1 bit = to keep track if a jump has been made on this input
-	// 2 bit = to keep track if a air-jump has been made
-	if(Grounded)
-		m_Jumped &= ~2;
-
-	// do hook
-	if(m_HookState == HOOK_IDLE)
-	{
-		m_HookedPlayer = -1;
-		m_HookState = HOOK_IDLE;
-		m_HookPos = m_Pos;
-	}
-	else if(m_HookState >= HOOK_RETRACT_START && m_HookState < HOOK_RETRACT_END)
-	{
-		m_HookState++;
-	}
-	else if(m_HookState == HOOK_RETRACT_END)
-	{
-		m_HookState = HOOK_RETRACTED;
-		m_HookState = HOOK_RETRACTED;
-	}
-	else if(m_HookState == HOOK_FLYING)
-	{
-		vec2 NewPos = m_HookPos+m_HookDir*pTuning->m_HookFireSpeed;
-		if(distance(m_Pos, NewPos) > pTuning->m_HookLength)
-		{
-			m_HookState = HOOK_RETRACT_START;
-			NewPos = m_Pos + normalize(NewPos-m_Pos) * pTuning->m_HookLength;
-		}
-
-		// make sure that the hook doesn't go though the ground
-		bool GoingToHitGround = false;
-		bool GoingToRetract = false;
-		ESMapItems Hit = IntersectLine(m_HookPos, NewPos, &NewPos, 0);
-		if(Hit != ESMapItems::TILEFLAG_AIR)
-		{
-			if(Hit&ESMapItems::TILEFLAG_UNHOOKABLE)
-				GoingToRetract = true;
-			else
-				GoingToHitGround = true;
-		}
-
-		// Check against other players first
-		if(pTuning->m_PlayerHooking)
-		{
-			float Distance = 0.0f;
-			for(int i = 0; i < MAX_CLIENTS; i++)
-			{
-				if(!s_aClients[i].m_Alive)
-					continue;
-				SCharacter *pCharCore = &s_aClients[i].m_Character;
-                if(pCharCore == this)
-                    continue;
-
-				vec2 ClosestPoint = closest_point_on_line(m_HookPos, NewPos, pCharCore->m_Pos);
-				if(distance(pCharCore->m_Pos, ClosestPoint) < PhysSize+2.0f)
-				{
-					if(m_HookedPlayer == -1 || distance(m_HookPos, pCharCore->m_Pos) < Distance)
-					{
-						m_HookState = HOOK_GRABBED;
-						m_HookedPlayer = i;
-						Distance = distance(m_HookPos, pCharCore->m_Pos);
-					}
-				}
-			}
-		}
-
-		if(m_HookState == HOOK_FLYING)
-		{
-			// check against ground
-			if(GoingToHitGround)
-			{
-				m_HookState = HOOK_GRABBED;
-			}
-			else if(GoingToRetract)
-			{
-				m_HookState = HOOK_RETRACT_START;
-			}
-
-			m_HookPos = NewPos;
-		}
-	}
-
-	if(m_HookState == HOOK_GRABBED)
-	{
-		if(m_HookedPlayer != -1)
-		{
-			SCharacter *pCharCore = &s_aClients[m_HookedPlayer].m_Character;
-			if(s_aClients[m_HookedPlayer].m_Alive)
-				m_HookPos = pCharCore->m_Pos;
-			else
-			{
-				// release hook
-				m_HookedPlayer = -1;
-				m_HookState = HOOK_RETRACTED;
-				m_HookPos = m_Pos;
-			}
-
-			// keep players hooked for a max of 1.5sec
-			//if(Server()->Tick() > hook_tick+(Server()->TickSpeed()*3)/2)
-				//release_hooked();
-		}
-
-		// don't do this hook rutine when we are hook to a player
-		if(m_HookedPlayer == -1 && distance(m_HookPos, m_Pos) > 46.0f)
-		{
-			vec2 HookVel = normalize(m_HookPos-m_Pos)*pTuning->m_HookDragAccel;
-			// the hook as more power to drag you up then down.
-			// this makes it easier to get on top of an platform
-			if(HookVel.y > 0)
-				HookVel.y *= 0.3f;
-
-			// the hook will boost it's power if the player wants to move
-			// in that direction. otherwise it will dampen everything abit
-			if((HookVel.x < 0 && m_Direction < 0) || (HookVel.x > 0 && m_Direction > 0))
-				HookVel.x *= 0.95f;
-			else
-				HookVel.x *= 0.75f;
-
-			vec2 NewVel = m_Vel+HookVel;
-
-			// check if we are under the legal limit for the hook
-			if(length(NewVel) < pTuning->m_HookDragSpeed || length(NewVel) < length(m_Vel))
-				m_Vel = NewVel; // no problem. apply
-
-		}
-
-		// release hook (max hook time is 1.25
-		m_HookTick++;
-		if(m_HookedPlayer != -1 && (m_HookTick > SERVER_TICK_SPEED+SERVER_TICK_SPEED/5 || !s_aClients[m_HookedPlayer].m_Alive))
-		{
-			m_HookedPlayer = -1;
-			m_HookState = HOOK_RETRACTED;
-			m_HookPos = m_Pos;
-		}
-	}
-
-    for(int i = 0; i < MAX_CLIENTS; i++)
-    {
-        if(!s_aClients[i].m_Alive)
-            continue;
-        SCharacter *pCharCore = &s_aClients[i].m_Character;
-        if(pCharCore == this)
-            continue;
-
-        // handle player <-> player collision
-        float Distance = distance(m_Pos, pCharCore->m_Pos);
-        vec2 Dir = normalize(m_Pos - pCharCore->m_Pos);
-        if(pTuning->m_PlayerCollision && Distance < PhysSize*1.25f && Distance > 0.0f)
-        {
-            float a = (PhysSize*1.45f - Distance);
-            float Velocity = 0.5f;
-
-            // make sure that we don't add excess force by checking the
-            // direction against the current velocity. if not zero.
-            if (length(m_Vel) > 0.0001)
-                Velocity = 1-(dot(normalize(m_Vel), Dir)+1)/2;
-
-            m_Vel += Dir*a*(Velocity*0.75f);
-            m_Vel *= 0.85f;
-        }
-
-        // handle hook influence
-        if(m_HookedPlayer == i && pTuning->m_PlayerHooking)
-        {
-            if(Distance > PhysSize*1.50f) // TODO: fix tweakable variable
-            {
-                float Accel = pTuning->m_HookDragAccel * (Distance/pTuning->m_HookLength);
-                float DragSpeed = pTuning->m_HookDragSpeed;
-
-                // add force to the hooked player
-                pCharCore->m_Vel.x = SaturatedAdd(-DragSpeed, DragSpeed, pCharCore->m_Vel.x, Accel*Dir.x*1.5f);
-                pCharCore->m_Vel.y = SaturatedAdd(-DragSpeed, DragSpeed, pCharCore->m_Vel.y, Accel*Dir.y*1.5f);
-
-                // add a little bit force to the guy who has the grip
-                m_Vel.x = SaturatedAdd(-DragSpeed, DragSpeed, m_Vel.x, -Accel*Dir.x*0.25f);
-                m_Vel.y = SaturatedAdd(-DragSpeed, DragSpeed, m_Vel.y, -Accel*Dir.y*0.25f);
-            }
-        }
-    }
-
-	// clamp the velocity to something sane
-	if(length(m_Vel) > 6000)
-		m_Vel = normalize(m_Vel) * 6000;
-
-    // move
-    float RampValue = VelocityRamp(length(m_Vel)*50, pTuning->m_VelrampStart, pTuning->m_VelrampRange, pTuning->m_VelrampCurvature);
-
-	m_Vel.x = m_Vel.x*RampValue;
-
-	vec2 NewPos = m_Pos;
-	MoveBox(&NewPos, &m_Vel, vec2(28.0f, 28.0f), 0);
-
-	m_Vel.x = m_Vel.x*(1.0f/RampValue);
-
-	if(pTuning->m_PlayerCollision)
-	{
-		// check player collision
-		float Distance = distance(m_Pos, NewPos);
-		int End = Distance+1;
-		vec2 LastPos = m_Pos;
-		for(int i = 0; i < End; i++)
-		{
-			float a = i/Distance;
-			vec2 Pos = mix(m_Pos, NewPos, a);
-			for(int p = 0; p < MAX_CLIENTS; p++)
-			{
-                if(!s_aClients[p].m_Alive)
-                    continue;
-                SCharacter *pCharCore = &s_aClients[p].m_Character;
-                if(pCharCore == this)
-                    continue;
-				float D = distance(Pos, pCharCore->m_Pos);
-				if(D < 28.0f && D > 0.0f)
-				{
-					if(a > 0.0f)
-						m_Pos = LastPos;
-					else if(distance(NewPos, pCharCore->m_Pos) > D)
-						m_Pos = NewPos;
-					return;
-				}
-			}
-			LastPos = Pos;
-		}
-	}
-
-	m_Pos = NewPos;
+    return s_Collision.IntersectLine(Pos0, Pos1, pOutCollision, pOutBeforeCollision);
 }
 
 void CSugarcane::InitTwsPart()
 {
     s_LocalID = -1;
-    s_pMap = nullptr;
-    s_pAStar = nullptr;
+    s_pFlowField = nullptr;
     s_MapWidth = 0;
     s_MapHeight = 0;
     s_TargetTeam = 0;
@@ -639,6 +333,43 @@ void CSugarcane::InitTwsPart()
     s_MouseTargetTo = vec2(0.f, 0.f);
 }
 
+void CSugarcane::TuningChanged()
+{
+    const CTuningParams *pTuning = DDNet::s_pClient->Tuning();
+    if(!memcmp(&s_PathRequest.m_NavTuning, pTuning, sizeof(CTuningParams)))
+        return;
+    s_PathRequest.m_NavTuning = *pTuning;
+    if(s_MapWidth > 0)
+    {
+        s_PathRequest.m_Tick = DDNet::s_pClient->GameTick();
+        s_PathWorker.Request(s_PathRequest);
+    }
+}
+
+void CSugarcane::ShutdownTwsPart()
+{
+    // both threads use the storage, which goes away after Run
+    s_MapWarmup.Stop();
+    s_PathWorker.Stop();
+}
+
+void CSugarcane::WarmUpMaps(const char *pServer)
+{
+    s_Server = pServer;
+    if(g_WarmupMaps <= 0)
+        return;
+
+    std::vector<std::pair<std::string, std::string>> vMaps;
+    Storage()->TwsRecentMaps(pServer, g_WarmupMaps, vMaps);
+    if(vMaps.empty())
+        return;
+    log_msgf("sugarcane/tws", "warm-up: preparing {} maps last played on {}", vMaps.size(), pServer);
+    // the server sends its tuning after the map, most keep the default and
+    // the path worker rebuilds the graph for the others
+    CTuningParams Tuning;
+    s_MapWarmup.Start(Storage(), vMaps, g_WarmupThreads, g_NavPathing ? &Tuning : nullptr, g_LandmarkPathing);
+}
+
 static float GetWeaponDistance(int Weapon)
 {
     switch(Weapon)
@@ -678,14 +409,76 @@ void CSugarcane::InputPrediction()
     };
 
     bool TargetHook = false;
+    auto ApplyNavAction = [&](int Tick)
+    {
+        SNavInput Input = NavActionInput(s_NavAction, Tick);
+        s_TickInput.m_Direction = Input.m_Direction;
+        s_TickInput.m_Jump = Input.m_Jump;
+        if(s_NavAction.m_Move == ENavMove::HOOK)
+        {
+            // the simulated hook direction has to be exact, skip the cursor easing
+            TargetHook = true;
+            s_TickInput.m_Hook = Input.m_Hook;
+            s_MouseTarget = s_MouseTargetTo = Input.m_HookDir * 200.f;
+            s_TickInput.m_TargetX = (int) s_MouseTarget.x;
+            s_TickInput.m_TargetY = (int) s_MouseTarget.y;
+        }
+    };
+
+    // follows the navigation graph, returns false if the grid path has to steer
+    auto NavMove = [&]()
+    {
+        if(!g_NavPathing || !s_pNavGraph || !s_DangerOverlay.Empty())
+        {
+            // danger cells are only known to the grid fields
+            s_NavActionTo = -1;
+            return false;
+        }
+
+        bool Grounded = CheckPoint(NowPos.x + PhysSize / 2, NowPos.y + PhysSize / 2 + 5) || CheckPoint(NowPos.x - PhysSize / 2, NowPos.y + PhysSize / 2 + 5);
+        int Node = Grounded ? s_pNavGraph->FindNode(NowPos) : -1;
+        if(s_NavActionTo >= 0)
+        {
+            int Tick = DDNet::s_pClient->GameTick() - s_NavActionStartTick;
+            if(Tick < s_NavAction.m_Ticks + g_NavActionSlack && !(Tick > 0 && Node == s_NavActionTo))
+            {
+                ApplyNavAction(Tick);
+                return true;
+            }
+            s_NavActionTo = -1;
+        }
+
+        int EdgeIndex = s_pNavField ? s_pNavField->NextEdge(Node) : -1;
+        if(EdgeIndex < 0)
+            return false;
+
+        const SNavEdge& Edge = s_pNavGraph->Edge(EdgeIndex);
+        if(Edge.m_Action.m_Move == ENavMove::WALK)
+        {
+            s_TickInput.m_Direction = Edge.m_Action.m_Direction;
+            return true;
+        }
+
+        s_NavAction = Edge.m_Action;
+        s_NavActionTo = Edge.m_To;
+        s_NavActionStartTick = DDNet::s_pClient->GameTick();
+        ApplyNavAction(0);
+        return true;
+    };
+
     auto Move = [&]()
     {
-        if(!s_pAStar)
+        if(NavMove())
         {
             return;
         }
 
-        std::vector<std::pair<int, int>> Path = s_pAStar->findPath({NowPos.y / 32, (NowPos.x + PhysSize / 2) / 32}, 20);
+        std::pair<int, int> Start = PathStart(NowPos);
+        std::vector<std::pair<int, int>> Path;
+        if(s_UseHierarchy || s_UseLandmarks)
+            Path = RouteFrom(Start);
+        else if(s_pFlowField)
+            Path = s_pFlowField->FindPath(Start, 20);
 
         if(Path.empty())
         {
@@ -790,12 +583,17 @@ void CSugarcane::OnNewSnapshot(void *pItem, const void *pData)
             CNetObj_Character *pObj = (CNetObj_Character *) pData;
 
             int ClientID = pSnapItem->m_ID;
-            s_aClients[ClientID].m_Character = *pObj;
-            s_aClients[ClientID].m_Character.m_Tick = s_aClients[ClientID].m_Character.m_LastSnapshotTick = pObj->m_Tick;
-            if(pObj->m_Tick) 
-                for(int64_t& Tick = s_aClients[ClientID].m_Character.m_Tick; Tick < DDNet::s_pClient->GameTick(); Tick++)
-                    s_aClients[ClientID].m_Character.Prediction();
+            SCharacter& Character = s_aClients[ClientID].m_Character;
+            // a resend after the full three seconds means the reckoning of the
+            // last state held, predicting it must give the new one exactly
+            if(s_aClients[ClientID].m_Alive && Character.m_LastSnapshotTick && pObj->m_Tick == Character.m_LastSnapshotTick + g_ReckoningTicks)
+                s_vReckoningChecks.push_back({ClientID, Character.m_LastSnapshotTick, Character.m_Reckoning});
+
+            Character = *pObj;
+            Character.m_Tick = Character.m_LastSnapshotTick = pObj->m_Tick;
+            Character.m_Reckoning = Character;
             s_aClients[ClientID].m_Alive = true;
+            s_vSnapCharacters.push_back(ClientID);
         }
         break;
 
@@ -891,28 +689,37 @@ void CSugarcane::DDNetTick(int *pInputData)
         float ClosetDistance = 9000.f;
         bool SelfInfect = IsInfectClass(s_LocalID);
 
-        s_MapGridWithEntity = s_MapGrid;
+        s_vDangerCells.clear();
         if(SelfInfect)
         {
             for(auto& Laser : s_vLasers)
-            {
-                float Distance = distance(Laser.m_From, Laser.m_To);
-                int End(Distance+1);
-                vec2 Last = Laser.m_From;
+                RasterizeSegment(Laser.m_From, Laser.m_To, s_MapWidth, s_MapHeight, g_LaserMargin, s_vDangerCells);
+            std::sort(s_vDangerCells.begin(), s_vDangerCells.end());
+            s_vDangerCells.erase(std::unique(s_vDangerCells.begin(), s_vDangerCells.end()), s_vDangerCells.end());
+        }
 
-                for(int i = 0; i < End; i++)
-                {
-                    float a = i/Distance;
-                    vec2 Pos = mix(Laser.m_From, Laser.m_To, a);
-                    Last = Pos;
-                    Pos /= 32;
-                    if(Pos.x < 0 || Pos.x >= s_MapWidth ||
-                        Pos.y < 0 || Pos.y >= s_MapHeight)
-                        break;
-
-                    s_MapGridWithEntity[Pos.y / 32][Pos.x / 32] = -1;
-                }
-            }
+        // the worker's searches, steer by the newest finished ones until
+        // the ones asked for below are done
+        s_pPathResult = s_PathWorker.Latest();
+        if(s_pPathResult)
+        {
+            s_pFlowField = s_pPathResult->m_pField.get();
+            // a maneuver heads for a node of the graph it was taken from
+            if(s_pNavGraph != s_pPathResult->m_pNavGraph.get())
+                s_NavActionTo = -1;
+            s_pNavGraph = s_pPathResult->m_pNavGraph.get();
+            s_pNavField = s_pPathResult->m_pNavField.get();
+            s_NumLandmarks = s_pPathResult->m_NumLandmarks;
+        }
+        bool PostRequest = false;
+
+        // cached fields stay valid until the set of danger cells changes,
+        // the worker applies them to the grid of its routes
+        s_vDangerChanges.clear();
+        if(s_DangerOverlay.Assign(s_vDangerCells, s_vDangerChanges))
+        {
+            s_PathRequest.m_vDangerCells = s_DangerOverlay.Cells();
+            PostRequest = true;
         }
 
         bool SearchNewTeammate = !s_pMoveTarget || s_LastFindTeammate + std::chrono::seconds(7) < std::chrono::system_clock::now();
@@ -969,21 +776,39 @@ void CSugarcane::DDNetTick(int *pInputData)
             {
                 if(Stronghold.first >= 3)
                 {
-                    s_MapDetail.SaveStronghold(Stronghold.second);
+                    if(!s_MapDetail.SaveStronghold(Stronghold.second))
+                        continue;
                     log_msgf("sugarcane/game", "找到新的据点 {},{}", Stronghold.second.x, Stronghold.second.y);
+
+                    // strongholds are where the bots keep going, they make good landmarks
+                    int Cell = clamp((int) (Stronghold.second.y / 32), 0, s_MapHeight - 1) * s_MapWidth + clamp((int) (Stronghold.second.x / 32), 0, s_MapWidth - 1);
+                    if(g_LandmarkPathing)
+                    {
+                        s_PathRequest.m_vLandmarkCells.push_back(Cell);
+                        PostRequest = true;
+                    }
                 }
             }
 
-            vec2 *pFindPos = nullptr;
-            s_MapDetail.FindNearestStronghold(NowPos, &pFindPos);
-            if(pFindPos && distance(*pFindPos, NowPos) > 480.0f)
+            // nearest by path length, searched on the worker
+            if(!s_MapDetail.m_vStrongholds.empty())
             {
-                s_FindStronghold = true;
-                s_StrongholdPos = *pFindPos;
-                s_pMoveTarget = nullptr;
+                s_PathRequest.m_vStrongholds.clear();
+                for(auto& Stronghold : s_MapDetail.m_vStrongholds)
+                    s_PathRequest.m_vStrongholds.push_back({Stronghold.y / 32, Stronghold.x / 32});
+                s_StrongholdSearch = ++s_PathRequest.m_StrongholdSearch;
+                PostRequest = true;
             }
+            else
+                HeadForStronghold(NowPos, -1);
             s_LastStrongholdFindTime = std::chrono::system_clock::now();
         }
+        if(s_StrongholdSearch && s_pPathResult && s_pPathResult->m_StrongholdSearch == s_StrongholdSearch)
+        {
+            const AStar *pStrongholdField = s_pPathResult->m_pStrongholdField.get();
+            HeadForStronghold(NowPos, pStrongholdField ? pStrongholdField->goalOf(NowPos.y / 32, NowPos.x / 32) : -1);
+            s_StrongholdSearch = 0;
+        }
 
         if(SelfInfect && s_pTarget)
             s_pMoveTarget = s_pTarget;
@@ -996,10 +821,69 @@ void CSugarcane::DDNetTick(int *pInputData)
         {
             s_GoToPos = s_StrongholdPos;
         }
-        if(s_pAStar)
-            delete s_pAStar;
+        SFieldKey Key = {clamp((int) (s_GoToPos.y / 32), 0, s_MapHeight - 1), clamp((int) (s_GoToPos.x / 32), 0, s_MapWidth - 1), s_DangerOverlay.Generation()};
+        if(g_IncrementalPathing && s_pFlowField)
+        {
+            // a goal that only drifted by a tile or two keeps steering by the
+            // previous field until the bot gets close to it
+            int BotY = (int) (NowPos.y / 32);
+            int BotX = (int) (NowPos.x / 32);
+            if(absolute(Key.m_GoalY - s_FieldKey.m_GoalY) <= g_GoalSlack && absolute(Key.m_GoalX - s_FieldKey.m_GoalX) <= g_GoalSlack &&
+                absolute(BotY - Key.m_GoalY) + absolute(BotX - Key.m_GoalX) > g_GoalSlackRange)
+            {
+                Key.m_GoalY = s_FieldKey.m_GoalY;
+                Key.m_GoalX = s_FieldKey.m_GoalX;
+            }
+        }
+
+        // far goals skip the full-map field, the hierarchy only walks the
+        // cluster the bot is in
+        s_UseHierarchy = g_HierarchicalPathing && s_HierarchyBuilt &&
+            absolute((int) (NowPos.y / 32) - Key.m_GoalY) + absolute((int) (NowPos.x / 32) - Key.m_GoalX) > g_HierarchyRange;
+        // a followed teammate moves the goal every tick, a field per position
+        // would be rebuilt all the time
+        s_UseLandmarks = g_LandmarkPathing && !s_UseHierarchy && s_pMoveTarget && s_NumLandmarks > 0;
+
+        // fields are asked for when the key changes, routes whenever the bot
+        // or the goal moved to another tile
+        bool Field = !s_UseHierarchy && !s_UseLandmarks;
+        if(Field && (!s_PathRequest.m_Field || !(Key == s_FieldKey)))
+        {
+            s_PathRequest.m_Key = Key;
+            s_FieldKey = Key;
+            PostRequest = true;
+        }
+        s_PathRequest.m_Field = Field;
+        int Route = s_UseHierarchy ? ROUTE_HIERARCHY : s_UseLandmarks ? ROUTE_LANDMARKS : ROUTE_NONE;
+        std::pair<int, int> RouteStart = Route != ROUTE_NONE ? PathStart(NowPos) : std::pair<int, int>(-1, -1);
+        std::pair<int, int> RouteGoal = Route != ROUTE_NONE ? std::pair<int, int>(Key.m_GoalY, Key.m_GoalX) : std::pair<int, int>(-1, -1);
+        if(Route != s_PathRequest.m_Route || RouteStart != s_PathRequest.m_RouteStart || RouteGoal != s_PathRequest.m_RouteGoal)
+        {
+            s_PathRequest.m_Route = Route;
+            s_PathRequest.m_RouteStart = RouteStart;
+            s_PathRequest.m_RouteGoal = RouteGoal;
+            PostRequest = true;
+        }
+        int NavGraph = s_pPathResult ? s_pPathResult->m_NavGraph : 0;
+        int GoalNode = s_pNavGraph ? s_pNavGraph->FindNodeBelow(s_GoToPos, g_NavGoalDrop) : -1;
+        if(NavGraph != s_PathRequest.m_NavGraph || GoalNode != s_PathRequest.m_NavGoal)
+        {
+            s_PathRequest.m_NavGraph = NavGraph;
+            s_PathRequest.m_NavGoal = GoalNode;
+            PostRequest = true;
+        }
+        if(PostRequest)
+        {
+            s_PathRequest.m_Tick = DDNet::s_pClient->GameTick();
+            s_PathWorker.Request(s_PathRequest);
+        }
+
+        if(Field && s_LastAgeTick != DDNet::s_pClient->GameTick())
+        {
+            s_LastAgeTick = DDNet::s_pClient->GameTick();
+            s_PathWorker.SampleAge(s_LastAgeTick);
+        }
 
-        s_pAStar = new AStar(s_MapGridWithEntity, {s_GoToPos.y / 32, s_GoToPos.x / 32});
         s_MouseTargetTo =  normalize(s_GoToPos - NowPos) * clamp(distance(s_GoToPos, NowPos), 0.f, 400.f);
 
         if(s_pTarget)
@@ -1035,10 +919,62 @@ void CSugarcane::StartSnap()
             Client.m_Active = false;
     }
     s_vLasers.clear();
+    s_vSnapCharacters.clear();
+    s_vReckoningChecks.clear();
 }
 
-bool CSugarcane::DownloadMap(const char *pMap, int Crc, void* pData, int Size)
+void CSugarcane::EndSnap()
 {
+    // the characters of the snapshot are from the tick the server last
+    // resent them, advance them the way the server did since
+    int64_t GameTick = DDNet::s_pClient->GameTick();
+    s_WorldSim.SetFlags(CWorldSim::FLAG_ALONE | CWorldSim::FLAG_QUANTIZE);
+    s_WorldSim.Clear();
+    for(int ClientID : s_vSnapCharacters)
+    {
+        SCharacter& Character = s_aClients[ClientID].m_Character;
+        if(Character.m_Tick)
+            s_WorldSim.SetCharacter(ClientID, Character, Character.m_Tick);
+    }
+    s_WorldSim.Run(GameTick, s_Collision, s_ReckoningTuning);
+
+    for(int ClientID : s_vSnapCharacters)
+    {
+        SCharacter& Character = s_aClients[ClientID].m_Character;
+        if(!Character.m_Tick || Character.m_Tick >= GameTick)
+            continue;
+        s_WorldSim.GetCharacter(ClientID, Character);
+        Character.m_Tick = GameTick;
+    }
+
+    for(const auto& Check : s_vReckoningChecks)
+    {
+        const SCharacter& Character = s_aClients[Check.m_ClientID].m_Character;
+        SCharacterCore Predicted;
+        s_WorldSim.Clear();
+        s_WorldSim.SetCharacter(Check.m_ClientID, Check.m_From, Check.m_FromTick);
+        s_WorldSim.Run(Character.m_LastSnapshotTick, s_Collision, s_ReckoningTuning);
+        s_WorldSim.GetCharacter(Check.m_ClientID, Predicted);
+
+        // misses are expected where the input changed on the resend tick
+        s_NumReckoningChecks++;
+        if(Predicted != Character.m_Reckoning)
+            s_NumReckoningMisses++;
+        if(s_NumReckoningChecks % 100 == 0)
+            log_msgf("sugarcane/tws", "prediction matched {} of {} resends", s_NumReckoningChecks - s_NumReckoningMisses, s_NumReckoningChecks);
+    }
+    s_vReckoningChecks.clear();
+}
+
+bool CSugarcane::DownloadMap(const char *pMap, int Crc, const void *pData, int Size)
+{
+    // the crc a server announces is the crc32 of the whole map file
+    uint32_t DataCrc = crc32(0, static_cast<const Bytef *>(pData), Size);
+    if(DataCrc != (uint32_t) Crc)
+    {
+        log_msgf("sugarcane/tws", "downloaded map {} has crc {:08x} instead of {:08x}", pMap, DataCrc, (uint32_t) Crc);
+        return false;
+    }
     return Storage()->TwsDownloadMap(pMap, std::to_string(Crc).c_str(), pData, Size);
 }
 
@@ -1047,42 +983,98 @@ bool CSugarcane::CheckMap(const char *pMap, int Crc)
     return Storage()->TwsMapExists(pMap, std::to_string(Crc).c_str());
 }
 
-bool CSugarcane::LoadMap(const char *pMap, int Crc)
+bool CSugarcane::LoadMap(const char *pMap, int Crc, const void *pData, int Size)
 {
-    if(s_pMap)
-        delete[] s_pMap;
-    s_pMap = nullptr;
+    s_Collision.Init(nullptr);
+    s_TileLayer.Clear();
+    s_Clearance.Clear();
     s_MapWidth = 0;
     s_MapHeight = 0;
 
     s_MapDetail.Reset();
     s_FindStronghold = false;
 
-    if(!ConvertMap(pMap, std::to_string(Crc).c_str(), &s_pMap, s_MapWidth, s_MapHeight))
+    s_PathWorker.Stop();
+    const CDistanceFieldCache& FieldCache = s_PathWorker.Cache();
+    if(FieldCache.Hits() || FieldCache.Misses())
     {
-        log_msg("sugarcane/tws", "failed to load teeworlds map");
-        return false;
+        log_msgf("sugarcane/tws", "path field cache: {} hits, {} misses, {} repairs, {} evictions, capacity {}", FieldCache.Hits(), FieldCache.Misses(), FieldCache.Repairs(), FieldCache.Evictions(), FieldCache.Capacity());
+        log_msgf("sugarcane/tws", "path worker: {} fields by {} search, result age {:.1f} ticks on average, {} at most", s_PathWorker.Solved(), CBitWavefront::BackendName(s_PathWorker.Backend()), s_PathWorker.MeanAge(), s_PathWorker.MaxAge());
+        log_msgf("sugarcane/tws", "flow fields: {} built, {} reused, {} alive", s_FlowFields.Built(), s_FlowFields.Reused(), s_FlowFields.Alive());
     }
-    
-    for(auto& Line : s_MapGrid)
+    s_pFlowField = nullptr;
+    s_pPathResult = nullptr;
+    s_PathRequest = SPathRequest();
+    s_StrongholdSearch = 0;
+    s_FieldKey = {-1, -1, 0};
+    s_DangerOverlay.Init(0, 0);
+    s_pNavGraph = nullptr;
+    s_pNavField = nullptr;
+    s_HierarchyBuilt = false;
+    s_UseHierarchy = false;
+    s_NumLandmarks = 0;
+    s_UseLandmarks = false;
+    s_NavActionTo = -1;
+
+    // a map the warm-up prepared is only swapped in
+    std::string CrcString = std::to_string(Crc);
+    std::unique_ptr<SPreparedMap> pPrepared;
+    bool Prepared = s_MapWarmup.Take(pMap, CrcString.c_str(), pPrepared);
+    // the maps the warm-up guessed wrong only take up memory from here on
+    s_MapWarmup.Release();
+    if(Prepared)
+        log_msgf("sugarcane/tws", "map {}/{} prepared by the warm-up", pMap, CrcString);
+    else
     {
-        Line.clear();
+        pPrepared = std::make_unique<SPreparedMap>();
+        // the worker builds the navigation graph once it knows the tuning
+        if(!PrepareMap(Storage(), pMap, CrcString.c_str(), pData, Size, nullptr, g_LandmarkPathing, *pPrepared))
+        {
+            log_msg("sugarcane/tws", "failed to load teeworlds map");
+            // the index went stale, the map is downloaded again
+            if(!pData)
+                Storage()->TwsDropMap(pMap, CrcString.c_str());
+            return false;
+        }
     }
 
-    s_MapGrid.clear();
-	s_MapGrid.resize(s_MapHeight);
-    for(int y = 0; y < s_MapHeight; y++)
+    std::swap(s_TileLayer, pPrepared->m_TileLayer);
+    std::swap(s_Clearance, pPrepared->m_Clearance);
+    s_Collision.Init(&s_TileLayer, &s_Clearance);
+    s_MapWidth = s_TileLayer.Width();
+    s_MapHeight = s_TileLayer.Height();
+    s_DangerOverlay.Init(s_MapWidth, s_MapHeight);
+    s_MapName = pMap;
+    s_MapCrc = CrcString;
+
+    // the grid, hierarchy and landmarks are searched on the worker from now on
+    s_HierarchyBuilt = pPrepared->m_PathHierarchy.Built();
+    s_NumLandmarks = pPrepared->m_Landmarks.NumLandmarks();
+    SPathMap PathMap;
+    PathMap.m_PathGrid = std::move(pPrepared->m_PathGrid);
+    PathMap.m_PathHierarchy = std::move(pPrepared->m_PathHierarchy);
+    PathMap.m_Landmarks = std::move(pPrepared->m_Landmarks);
+    // the graph depends on the tuning, which the warm-up could only guess
+    // and the server sends after the map, the worker simulates it again
+    // when the tuning asked for differs
+    PathMap.m_Nav = g_NavPathing;
+    if(g_NavPathing && pPrepared->m_HasNavGraph)
     {
-	    s_MapGrid[y].resize(s_MapWidth);
-        for(int x = 0; x < s_MapWidth; x++)
-        {
-            s_MapGrid[y][x] = 0;
-            if(s_pMap[y * s_MapWidth + x] & ESMapItems::TILEFLAG_SOLID)
-                s_MapGrid[y][x] = 1;
-            if(s_pMap[y * s_MapWidth + x] & ESMapItems::TILEFLAG_DEATH)
-                s_MapGrid[y][x] = -1;
-        }
+        PathMap.m_pNavGraph = std::make_shared<CNavGraph>(std::move(pPrepared->m_NavGraph));
+        PathMap.m_NavTuning = pPrepared->m_NavTuning;
     }
+    PathMap.m_Clearance = s_Clearance;
+    s_PathRequest.m_NavTuning = *DDNet::s_pClient->Tuning();
+    PathMap.m_pStorage = Storage();
+    PathMap.m_Map = s_MapName;
+    PathMap.m_Crc = s_MapCrc;
+
+    // one field costs a byte of flags and two bytes of distance per tile
+    s_PathWorker.Start(s_TileLayer, std::hash<std::string>()(s_MapName + "/" + s_MapCrc), &s_FlowFields, clamp<size_t>(g_FieldCacheBudget / ((size_t) s_MapWidth * s_MapHeight * 3), 2, 64), g_IncrementalPathing, PathMap);
+
+    // keeps the map and its artifacts from being evicted, the store index is
+    // saved later on the storage thread
+    Storage()->TwsUseMap(pMap, s_MapCrc.c_str(), s_Server.c_str());
     return true;
 }
 
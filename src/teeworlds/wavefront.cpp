@@ -0,0 +1,230 @@
+#include <include/base.h>
+
+#include "wavefront.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WAVEFRONT_X86 1
+#endif
+
+// One bit per tile of a row whose flags equal OpenFlags.
+typedef void (*FPackRow)(const uint8_t *pRow, uint8_t OpenFlags, int Cols, uint64_t *pOpen);
+
+static void PackRowBits(const uint8_t *pRow, uint8_t OpenFlags, int Cols, uint64_t *pOpen)
+{
+    for(int x = 0; x < Cols; x += 64)
+    {
+        int End = std::min(Cols - x, 64);
+        uint64_t Bits = 0;
+        for(int b = 0; b < End; b++)
+            Bits |= (uint64_t) (pRow[x + b] == OpenFlags) << b;
+        pOpen[x / 64] = Bits;
+    }
+}
+
+// A row of the next frontier: the frontier grown one tile sideways and by
+// the rows above and below, limited to open tiles not visited yet. Returns
+// whether anything was reached. pFrontier, pUp and pDown point at the first
+// word of their row, the word before and after it are guard words.
+static inline bool ExpandRowBits(const uint64_t *pFrontier, const uint64_t *pUp, const uint64_t *pDown, const uint64_t *pOpen, uint64_t *pVisited, uint64_t *pNext, int Words)
+{
+    uint64_t Any = 0;
+    for(int w = 0; w < Words; w++)
+    {
+        uint64_t Grown = pFrontier[w] | pFrontier[w] << 1 | pFrontier[w - 1] >> 63 | pFrontier[w] >> 1 | pFrontier[w + 1] << 63 | pUp[w] | pDown[w];
+        uint64_t Reached = Grown & pOpen[w] & ~pVisited[w];
+        pVisited[w] |= Reached;
+        pNext[w] = Reached;
+        Any |= Reached;
+    }
+    return Any;
+}
+
+#ifdef WAVEFRONT_X86
+__attribute__((target("avx2"))) static inline bool ExpandRowAvx2(const uint64_t *pFrontier, const uint64_t *pUp, const uint64_t *pDown, const uint64_t *pOpen, uint64_t *pVisited, uint64_t *pNext, int Words)
+{
+    // rows are padded to whole registers, so this never reads past them
+    __m256i Any = _mm256_setzero_si256();
+    for(int w = 0; w < Words; w += 4)
+    {
+        __m256i Current = _mm256_loadu_si256((const __m256i *) (pFrontier + w));
+        __m256i Left = _mm256_loadu_si256((const __m256i *) (pFrontier + w - 1));
+        __m256i Right = _mm256_loadu_si256((const __m256i *) (pFrontier + w + 1));
+        __m256i Grown = _mm256_or_si256(Current, _mm256_slli_epi64(Current, 1));
+        Grown = _mm256_or_si256(Grown, _mm256_srli_epi64(Left, 63));
+        Grown = _mm256_or_si256(Grown, _mm256_srli_epi64(Current, 1));
+        Grown = _mm256_or_si256(Grown, _mm256_slli_epi64(Right, 63));
+        Grown = _mm256_or_si256(Grown, _mm256_loadu_si256((const __m256i *) (pUp + w)));
+        Grown = _mm256_or_si256(Grown, _mm256_loadu_si256((const __m256i *) (pDown + w)));
+
+        __m256i Visited = _mm256_loadu_si256((const __m256i *) (pVisited + w));
+        __m256i Reached = _mm256_andnot_si256(Visited, _mm256_and_si256(Grown, _mm256_loadu_si256((const __m256i *) (pOpen + w))));
+        _mm256_storeu_si256((__m256i *) (pVisited + w), _mm256_or_si256(Visited, Reached));
+        _mm256_storeu_si256((__m256i *) (pNext + w), Reached);
+        Any = _mm256_or_si256(Any, Reached);
+    }
+    return !_mm256_testz_si256(Any, Any);
+}
+
+__attribute__((target("avx2"))) static void PackRowAvx2(const uint8_t *pRow, uint8_t OpenFlags, int Cols, uint64_t *pOpen)
+{
+    __m256i Open = _mm256_set1_epi8((char) OpenFlags);
+    int x = 0;
+    for(; x + 64 <= Cols; x += 64)
+    {
+        uint32_t Low = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (pRow + x)), Open));
+        uint32_t High = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (pRow + x + 32)), Open));
+        pOpen[x / 64] = (uint64_t) High << 32 | Low;
+    }
+    if(x < Cols)
+        PackRowBits(pRow + x, OpenFlags, Cols - x, pOpen + x / 64);
+}
+#endif
+
+bool CBitWavefront::Supported(int Backend)
+{
+    switch(Backend)
+    {
+    case BACKEND_QUEUE:
+    case BACKEND_BITS:
+        return true;
+    case BACKEND_AVX2:
+#ifdef WAVEFRONT_X86
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+int CBitWavefront::BitBackend()
+{
+    static const int s_Backend = Supported(BACKEND_AVX2) ? BACKEND_AVX2 : BACKEND_BITS;
+    return s_Backend;
+}
+
+const char *CBitWavefront::BackendName(int Backend)
+{
+    static const char *s_apNames[] = {"queue", "bits", "avx2"};
+    return Backend >= 0 && Backend < NUM_BACKENDS ? s_apNames[Backend] : "unknown";
+}
+
+template<typename FExpand>
+inline __attribute__((always_inline)) void CBitWavefront::Spread(int Rows, int Cols, uint16_t *pDistance, FExpand &&Expand)
+{
+    int Words = (Cols + 63) / 64;
+    auto Row = [&](std::vector<uint64_t>& vBits, int y) { return vBits.data() + (size_t) (y + 1) * m_Stride + 1; };
+
+    for(uint16_t Level = 1; Level < UNREACHED && !m_vActive.empty(); Level++)
+    {
+        // a row can only be reached from a frontier row next to it, and only
+        // one word further sideways than that frontier spans. The rows stay
+        // sorted, so a candidate can only repeat one of the last few.
+        m_vCandidates.clear();
+        for(const SRowSpan& Active : m_vActive)
+        {
+            int First = std::max(Active.m_First - 1, 0);
+            int Last = std::min(Active.m_Last + 1, Words - 1);
+            for(int y = std::max(Active.m_Y - 1, 0); y <= std::min(Active.m_Y + 1, Rows - 1); y++)
+            {
+                size_t i = m_vCandidates.size();
+                while(i > 0 && m_vCandidates[i - 1].m_Y > y)
+                    i--;
+                if(i > 0 && m_vCandidates[i - 1].m_Y == y)
+                {
+                    m_vCandidates[i - 1].m_First = std::min(m_vCandidates[i - 1].m_First, First);
+                    m_vCandidates[i - 1].m_Last = std::max(m_vCandidates[i - 1].m_Last, Last);
+                }
+                else
+                    m_vCandidates.push_back({y, First, Last});
+            }
+        }
+
+        m_vNextActive.clear();
+        for(const SRowSpan& Candidate : m_vCandidates)
+        {
+            // whole registers, the rows are padded for that
+            int y = Candidate.m_Y;
+            int First = Candidate.m_First & ~3;
+            int Count = (Candidate.m_Last + 1 - First + 3) & ~3;
+            uint64_t *pNext = Row(m_vNext, y);
+            if(!Expand(Row(m_vFrontier, y) + First, Row(m_vFrontier, y - 1) + First, Row(m_vFrontier, y + 1) + First, Row(m_vOpen, y) + First, Row(m_vVisited, y) + First, pNext + First, Count))
+                continue;
+
+            SRowSpan Span = {y, Words, -1};
+            uint16_t *pRowDistance = pDistance + (size_t) y * Cols;
+            for(int w = First; w < std::min(First + Count, Words); w++)
+            {
+                if(!pNext[w])
+                    continue;
+                Span.m_First = std::min(Span.m_First, w);
+                Span.m_Last = w;
+                for(uint64_t Bits = pNext[w]; Bits; Bits &= Bits - 1)
+                    pRowDistance[w * 64 + __builtin_ctzll(Bits)] = Level;
+            }
+            m_vNextActive.push_back(Span);
+        }
+
+        // the old frontier becomes the zeroed buffer of the next level
+        for(const SRowSpan& Active : m_vActive)
+            memset(Row(m_vFrontier, Active.m_Y) + Active.m_First, 0, (Active.m_Last + 1 - Active.m_First) * sizeof(uint64_t));
+        m_vFrontier.swap(m_vNext);
+        m_vActive.swap(m_vNextActive);
+    }
+}
+
+#ifdef WAVEFRONT_X86
+// the whole level loop is compiled for AVX2, so the kernel is inlined
+__attribute__((target("avx2"))) void CBitWavefront::SpreadAvx2(int Rows, int Cols, uint16_t *pDistance)
+{
+    Spread(Rows, Cols, pDistance, ExpandRowAvx2);
+}
+#endif
+
+void CBitWavefront::Fill(const uint8_t *pCells, uint8_t OpenFlags, int Rows, int Cols, int Goal, uint16_t *pDistance, int Backend)
+{
+    if(Rows <= 0 || Cols <= 0 || Goal < 0 || Goal >= Rows * Cols)
+        return;
+
+    bool Avx2 = Backend == BACKEND_AVX2 && Supported(BACKEND_AVX2);
+    FPackRow pfnPack = PackRowBits;
+#ifdef WAVEFRONT_X86
+    if(Avx2)
+        pfnPack = PackRowAvx2;
+#endif
+
+    // every row starts one word in and is padded to whole AVX2 registers;
+    // a guard row above and below stays zero
+    int Words = (Cols + 63) / 64;
+    int PaddedWords = (Words + 3) & ~3;
+    m_Stride = PaddedWords + 2;
+    size_t Size = (size_t) (Rows + 2) * m_Stride;
+    m_vOpen.assign(Size, 0);
+    m_vVisited.assign(Size, 0);
+    m_vFrontier.assign(Size, 0);
+    m_vNext.assign(Size, 0);
+    auto Row = [&](std::vector<uint64_t>& vBits, int y) { return vBits.data() + (size_t) (y + 1) * m_Stride + 1; };
+
+    for(int y = 0; y < Rows; y++)
+        pfnPack(pCells + (size_t) y * Cols, OpenFlags, Cols, Row(m_vOpen, y));
+
+    int GoalY = Goal / Cols;
+    int GoalX = Goal % Cols;
+    Row(m_vVisited, GoalY)[GoalX / 64] |= (uint64_t) 1 << (GoalX % 64);
+    Row(m_vFrontier, GoalY)[GoalX / 64] |= (uint64_t) 1 << (GoalX % 64);
+    pDistance[Goal] = 0;
+
+    m_vActive.assign(1, {GoalY, GoalX / 64, GoalX / 64});
+#ifdef WAVEFRONT_X86
+    if(Avx2)
+    {
+        SpreadAvx2(Rows, Cols, pDistance);
+        return;
+    }
+#endif
+    Spread(Rows, Cols, pDistance, ExpandRowBits);
+}
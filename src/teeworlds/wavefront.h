@@ -0,0 +1,58 @@
+#ifndef TEEWORLDS_WAVEFRONT_H
+#define TEEWORLDS_WAVEFRONT_H
+
+#include <cstdint>
+#include <vector>
+
+// Breadth-first distance fill that keeps the open, visited and frontier
+// tiles as one bit per tile. A whole row of the frontier grows by one step
+// with a few shifts and ANDs, 64 tiles per word, or 256 per register where
+// AVX2 is available. Only the rows around the current frontier are touched.
+class CBitWavefront
+{
+public:
+    enum
+    {
+        BACKEND_QUEUE = 0, // the plain FIFO search of AStar
+        BACKEND_BITS,
+        BACKEND_AVX2,
+        NUM_BACKENDS,
+    };
+
+    static constexpr uint16_t UNREACHED = 0xffff;
+
+    static bool Supported(int Backend);
+    // the widest bit backend this CPU runs
+    static int BitBackend();
+    static const char *BackendName(int Backend);
+
+    // Fills pDistance from Goal. A tile is entered if its flags in pCells
+    // equal OpenFlags; the goal itself is always reached. pDistance must
+    // hold UNREACHED for every tile beforehand.
+    void Fill(const uint8_t *pCells, uint8_t OpenFlags, int Rows, int Cols, int Goal, uint16_t *pDistance, int Backend);
+
+private:
+    // a row of the frontier and the words it occupies
+    struct SRowSpan
+    {
+        int m_Y;
+        int m_First;
+        int m_Last;
+    };
+
+    int m_Stride; // words per row, with a guard word on both ends
+    std::vector<uint64_t> m_vOpen;
+    std::vector<uint64_t> m_vVisited;
+    std::vector<uint64_t> m_vFrontier;
+    std::vector<uint64_t> m_vNext;
+    std::vector<SRowSpan> m_vActive; // sorted by row
+    std::vector<SRowSpan> m_vNextActive;
+    std::vector<SRowSpan> m_vCandidates;
+
+    // grows the frontier level by level until it runs dry
+    template<typename FExpand>
+    void Spread(int Rows, int Cols, uint16_t *pDistance, FExpand &&Expand);
+    void SpreadAvx2(int Rows, int Cols, uint16_t *pDistance);
+};
+
+#endif // TEEWORLDS_WAVEFRONT_H
@@ -0,0 +1,380 @@
+#include <include/base.h>
+
+#include <teeworlds/six/gamecore.h>
+#include <teeworlds/six/math.h>
+
+#include "worldsim.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const float s_PhysSize = 28.0f;
+
+CWorldSim::CWorldSim()
+{
+    m_Flags = 0;
+    Clear();
+}
+
+void CWorldSim::Clear()
+{
+    m_Tick = 0;
+    m_Num = 0;
+    m_NumOrder = 0;
+    std::fill(std::begin(m_aPresent), std::end(m_aPresent), 0);
+    std::fill(std::begin(m_aRunning), std::end(m_aRunning), 0);
+}
+
+void CWorldSim::SetCharacter(int ID, const SCharacterCore& Core, int64_t Tick)
+{
+    if(ID < 0 || ID >= MAX_CHARACTERS)
+        return;
+
+    m_aPosX[ID] = Core.m_Pos.x;
+    m_aPosY[ID] = Core.m_Pos.y;
+    m_aVelX[ID] = Core.m_Vel.x;
+    m_aVelY[ID] = Core.m_Vel.y;
+    m_aHookPosX[ID] = Core.m_HookPos.x;
+    m_aHookPosY[ID] = Core.m_HookPos.y;
+    m_aHookDirX[ID] = Core.m_HookDir.x;
+    m_aHookDirY[ID] = Core.m_HookDir.y;
+    m_aDirection[ID] = Core.m_Direction;
+    m_aJumped[ID] = Core.m_Jumped;
+    m_aHookedPlayer[ID] = Core.m_HookedPlayer;
+    m_aHookState[ID] = Core.m_HookState;
+    m_aHookTick[ID] = Core.m_HookTick;
+    m_aStartTick[ID] = Tick;
+    if(!m_aPresent[ID])
+        m_aOrder[m_NumOrder++] = ID;
+    m_aPresent[ID] = 1;
+    m_Num = std::max(m_Num, ID + 1);
+}
+
+void CWorldSim::GetCharacter(int ID, SCharacterCore& Core) const
+{
+    Core.m_Pos = Pos(ID);
+    Core.m_Vel = Vel(ID);
+    Core.m_HookPos = vec2(m_aHookPosX[ID], m_aHookPosY[ID]);
+    Core.m_HookDir = vec2(m_aHookDirX[ID], m_aHookDirY[ID]);
+    Core.m_Direction = m_aDirection[ID];
+    Core.m_Jumped = m_aJumped[ID];
+    Core.m_HookedPlayer = m_aHookedPlayer[ID];
+    Core.m_HookState = m_aHookState[ID];
+    Core.m_HookTick = m_aHookTick[ID];
+}
+
+void CWorldSim::Run(int64_t ToTick, const CCollision& Collision, const CTuningParams& Tuning)
+{
+    bool Any = false;
+    for(int i = 0; i < m_Num; i++)
+    {
+        if(!m_aPresent[i])
+            continue;
+        m_Tick = Any ? std::min(m_Tick, m_aStartTick[i]) : m_aStartTick[i];
+        Any = true;
+    }
+    if(!Any)
+        return;
+
+    while(m_Tick < ToTick)
+        Step(Collision, Tuning);
+}
+
+void CWorldSim::Step(const CCollision& Collision, const CTuningParams& Tuning)
+{
+    const int Num = m_Num;
+    for(int i = 0; i < Num; i++)
+        m_aRunning[i] = m_aPresent[i] && m_aStartTick[i] <= m_Tick;
+
+    // ground state, two tile lookups each
+    for(int i = 0; i < Num; i++)
+        m_aGrounded[i] = m_aRunning[i] && (Collision.CheckPoint(m_aPosX[i] + s_PhysSize / 2, m_aPosY[i] + s_PhysSize / 2 + 5) ||
+            Collision.CheckPoint(m_aPosX[i] - s_PhysSize / 2, m_aPosY[i] + s_PhysSize / 2 + 5));
+
+    // in turn, a hooked player is dragged before its own tick when the
+    // hooking one comes first
+    for(int k = 0; k < m_NumOrder; k++)
+    {
+        int i = m_aOrder[k];
+        if(!m_aRunning[i])
+            continue;
+        TickControl(i, Tuning);
+        TickHook(i, Collision, Tuning);
+        TickPlayers(i, Tuning);
+    }
+
+    // the velocity ramp of every mover
+    for(int i = 0; i < Num; i++)
+        m_aRamp[i] = m_aRunning[i] ? VelocityRamp(std::sqrt(m_aVelX[i] * m_aVelX[i] + m_aVelY[i] * m_aVelY[i]) * 50, Tuning.m_VelrampStart, Tuning.m_VelrampRange, Tuning.m_VelrampCurvature) : 1.0f;
+
+    // moves one after the other, later ones see where the earlier ones went
+    for(int k = 0; k < m_NumOrder; k++)
+    {
+        int i = m_aOrder[k];
+        if(!m_aRunning[i])
+            continue;
+        Move(i, Collision, Tuning);
+        if(m_Flags & FLAG_QUANTIZE)
+            Quantize(i);
+    }
+
+    m_Tick++;
+}
+
+void CWorldSim::TickControl(int i, const CTuningParams& Tuning)
+{
+    bool Grounded = m_aGrounded[i];
+    float MaxSpeed = Grounded ? Tuning.m_GroundControlSpeed : Tuning.m_AirControlSpeed;
+    float Accel = Grounded ? Tuning.m_GroundControlAccel : Tuning.m_AirControlAccel;
+    float Friction = Grounded ? Tuning.m_GroundFriction : Tuning.m_AirFriction;
+
+    m_aVelY[i] += Tuning.m_Gravity;
+
+    // the speed modification according to the wanted direction
+    if(m_aDirection[i] < 0)
+        m_aVelX[i] = SaturatedAdd(-MaxSpeed, MaxSpeed, m_aVelX[i], -Accel);
+    else if(m_aDirection[i] > 0)
+        m_aVelX[i] = SaturatedAdd(-MaxSpeed, MaxSpeed, m_aVelX[i], Accel);
+    else
+        m_aVelX[i] *= Friction;
+
+    if(Grounded)
+        m_aJumped[i] &= ~2;
+}
+
+void CWorldSim::TickHook(int i, const CCollision& Collision, const CTuningParams& Tuning)
+{
+    vec2 Pos = this->Pos(i);
+    vec2 HookPos(m_aHookPosX[i], m_aHookPosY[i]);
+    int& HookState = m_aHookState[i];
+    int& HookedPlayer = m_aHookedPlayer[i];
+
+    if(HookState == HOOK_IDLE)
+    {
+        HookedPlayer = -1;
+        HookPos = Pos;
+    }
+    else if(HookState >= HOOK_RETRACT_START && HookState < HOOK_RETRACT_END)
+        HookState++;
+    else if(HookState == HOOK_RETRACT_END)
+        HookState = HOOK_RETRACTED;
+    else if(HookState == HOOK_FLYING)
+    {
+        vec2 NewPos = HookPos + vec2(m_aHookDirX[i], m_aHookDirY[i]) * Tuning.m_HookFireSpeed;
+        if(distance(Pos, NewPos) > Tuning.m_HookLength)
+        {
+            HookState = HOOK_RETRACT_START;
+            NewPos = Pos + normalize(NewPos - Pos) * Tuning.m_HookLength;
+        }
+
+        // make sure that the hook doesn't go though the ground
+        bool GoingToHitGround = false;
+        bool GoingToRetract = false;
+        ESMapItems Hit = Collision.IntersectLine(HookPos, NewPos, &NewPos, 0);
+        if(Hit != ESMapItems::TILEFLAG_AIR)
+        {
+            if(Hit & ESMapItems::TILEFLAG_UNHOOKABLE)
+                GoingToRetract = true;
+            else
+                GoingToHitGround = true;
+        }
+
+        // other players first
+        if(Tuning.m_PlayerHooking)
+        {
+            float Distance = 0.0f;
+            for(int j = 0; j < m_Num; j++)
+            {
+                if(!Sees(i, j))
+                    continue;
+                vec2 ClosestPoint = closest_point_on_line(HookPos, NewPos, this->Pos(j));
+                if(distance(this->Pos(j), ClosestPoint) < s_PhysSize + 2.0f)
+                {
+                    if(HookedPlayer == -1 || distance(HookPos, this->Pos(j)) < Distance)
+                    {
+                        HookState = HOOK_GRABBED;
+                        HookedPlayer = j;
+                        Distance = distance(HookPos, this->Pos(j));
+                    }
+                }
+            }
+        }
+
+        if(HookState == HOOK_FLYING)
+        {
+            if(GoingToHitGround)
+                HookState = HOOK_GRABBED;
+            else if(GoingToRetract)
+                HookState = HOOK_RETRACT_START;
+            HookPos = NewPos;
+        }
+    }
+
+    if(HookState == HOOK_GRABBED)
+    {
+        if(HookedPlayer != -1)
+        {
+            if(Sees(i, HookedPlayer))
+                HookPos = this->Pos(HookedPlayer);
+            else
+            {
+                // release hook
+                HookedPlayer = -1;
+                HookState = HOOK_RETRACTED;
+                HookPos = Pos;
+            }
+        }
+
+        // the drag towards the hook, not when hooking a player
+        if(HookedPlayer == -1 && distance(HookPos, Pos) > 46.0f)
+        {
+            vec2 HookVel = normalize(HookPos - Pos) * Tuning.m_HookDragAccel;
+            // the hook as more power to drag you up then down.
+            // this makes it easier to get on top of an platform
+            if(HookVel.y > 0)
+                HookVel.y *= 0.3f;
+
+            // the hook will boost it's power if the player wants to move
+            // in that direction. otherwise it will dampen everything abit
+            if((HookVel.x < 0 && m_aDirection[i] < 0) || (HookVel.x > 0 && m_aDirection[i] > 0))
+                HookVel.x *= 0.95f;
+            else
+                HookVel.x *= 0.75f;
+
+            vec2 NewVel = Vel(i) + HookVel;
+
+            // check if we are under the legal limit for the hook
+            if(length(NewVel) < Tuning.m_HookDragSpeed || length(NewVel) < length(Vel(i)))
+                SetVel(i, NewVel);
+        }
+
+        // release hook (max hook time is 1.25
+        m_aHookTick[i]++;
+        if(HookedPlayer != -1 && (m_aHookTick[i] > SERVER_TICK_SPEED + SERVER_TICK_SPEED / 5 || !Sees(i, HookedPlayer)))
+        {
+            HookedPlayer = -1;
+            HookState = HOOK_RETRACTED;
+            HookPos = Pos;
+        }
+    }
+
+    m_aHookPosX[i] = HookPos.x;
+    m_aHookPosY[i] = HookPos.y;
+}
+
+void CWorldSim::TickPlayers(int i, const CTuningParams& Tuning)
+{
+    vec2 Pos = this->Pos(i);
+    for(int j = 0; j < m_Num; j++)
+    {
+        if(!Sees(i, j))
+            continue;
+
+        // player <-> player collision
+        float Distance = distance(Pos, this->Pos(j));
+        vec2 Dir = normalize(Pos - this->Pos(j));
+        if(Tuning.m_PlayerCollision && Distance < s_PhysSize * 1.25f && Distance > 0.0f)
+        {
+            float a = (s_PhysSize * 1.45f - Distance);
+            float Velocity = 0.5f;
+
+            // make sure that we don't add excess force by checking the
+            // direction against the current velocity. if not zero.
+            if(length(Vel(i)) > 0.0001)
+                Velocity = 1 - (dot(normalize(Vel(i)), Dir) + 1) / 2;
+
+            vec2 NewVel = Vel(i) + Dir * a * (Velocity * 0.75f);
+            SetVel(i, NewVel * 0.85f);
+        }
+
+        // hook influence
+        if(m_aHookedPlayer[i] == j && Tuning.m_PlayerHooking)
+        {
+            if(Distance > s_PhysSize * 1.50f) // TODO: fix tweakable variable
+            {
+                float Accel = Tuning.m_HookDragAccel * (Distance / Tuning.m_HookLength);
+                float DragSpeed = Tuning.m_HookDragSpeed;
+
+                // add force to the hooked player
+                m_aVelX[j] = SaturatedAdd(-DragSpeed, DragSpeed, m_aVelX[j], Accel * Dir.x * 1.5f);
+                m_aVelY[j] = SaturatedAdd(-DragSpeed, DragSpeed, m_aVelY[j], Accel * Dir.y * 1.5f);
+
+                // add a little bit force to the guy who has the grip
+                m_aVelX[i] = SaturatedAdd(-DragSpeed, DragSpeed, m_aVelX[i], -Accel * Dir.x * 0.25f);
+                m_aVelY[i] = SaturatedAdd(-DragSpeed, DragSpeed, m_aVelY[i], -Accel * Dir.y * 0.25f);
+            }
+        }
+    }
+
+    // clamp the velocity to something sane
+    if(length(Vel(i)) > 6000)
+        SetVel(i, normalize(Vel(i)) * 6000);
+}
+
+void CWorldSim::Move(int i, const CCollision& Collision, const CTuningParams& Tuning)
+{
+    vec2 Pos = this->Pos(i);
+    vec2 Vel(m_aVelX[i] * m_aRamp[i], m_aVelY[i]);
+
+    vec2 NewPos = Pos;
+    Collision.MoveBox(&NewPos, &Vel, vec2(s_PhysSize, s_PhysSize), 0);
+    SetVel(i, vec2(Vel.x * (1.0f / m_aRamp[i]), Vel.y));
+
+    // stop in front of the first player on the way
+    if(Tuning.m_PlayerCollision)
+    {
+        float Distance = distance(Pos, NewPos);
+
+        // only players this close to the start can be touched on the way
+        float Reach = Distance + s_PhysSize + 1.0f;
+        int aNear[MAX_CHARACTERS];
+        int NumNear = 0;
+        for(int j = 0; j < m_Num; j++)
+        {
+            float dx = m_aPosX[j] - Pos.x;
+            float dy = m_aPosY[j] - Pos.y;
+            aNear[NumNear] = j;
+            NumNear += Sees(i, j) && dx * dx + dy * dy < Reach * Reach;
+        }
+
+        int End = Distance + 1;
+        vec2 LastPos = Pos;
+        for(int Step = 0; NumNear && Step < End; Step++)
+        {
+            float a = Step / Distance;
+            vec2 StepPos = mix(Pos, NewPos, a);
+            for(int n = 0; n < NumNear; n++)
+            {
+                int j = aNear[n];
+                float D = distance(StepPos, this->Pos(j));
+                if(D < s_PhysSize && D > 0.0f)
+                {
+                    if(a > 0.0f)
+                        NewPos = LastPos;
+                    else if(distance(NewPos, this->Pos(j)) <= D)
+                        NewPos = Pos;
+                    m_aPosX[i] = NewPos.x;
+                    m_aPosY[i] = NewPos.y;
+                    return;
+                }
+            }
+            LastPos = StepPos;
+        }
+    }
+
+    m_aPosX[i] = NewPos.x;
+    m_aPosY[i] = NewPos.y;
+}
+
+void CWorldSim::Quantize(int i)
+{
+    // what is left of the core after a round trip through CNetObj_CharacterCore
+    m_aPosX[i] = round_to_int(m_aPosX[i]);
+    m_aPosY[i] = round_to_int(m_aPosY[i]);
+    m_aVelX[i] = round_to_int(m_aVelX[i] * 256.0f) / 256.0f;
+    m_aVelY[i] = round_to_int(m_aVelY[i] * 256.0f) / 256.0f;
+    m_aHookPosX[i] = round_to_int(m_aHookPosX[i]);
+    m_aHookPosY[i] = round_to_int(m_aHookPosY[i]);
+    m_aHookDirX[i] = round_to_int(m_aHookDirX[i] * 256.0f) / 256.0f;
+    m_aHookDirY[i] = round_to_int(m_aHookDirY[i] * 256.0f) / 256.0f;
+}
@@ -0,0 +1,114 @@
+#ifndef TEEWORLDS_WORLDSIM_H
+#define TEEWORLDS_WORLDSIM_H
+
+#include <teeworlds/map/collision.h>
+#include <teeworlds/six/protocol.h>
+#include <teeworlds/six/tune.h>
+
+#include <cstdint>
+
+// What the world simulation advances of a character.
+struct SCharacterCore
+{
+    vec2 m_Pos;
+    vec2 m_Vel;
+    vec2 m_HookPos;
+    vec2 m_HookDir;
+    int m_Direction;
+    int m_Jumped;
+    int m_HookedPlayer;
+    int m_HookState;
+    int m_HookTick;
+
+    bool operator==(const SCharacterCore&) const = default;
+};
+
+// All characters of a world advanced together, a tick at a time, in the
+// order the server uses: every core ticks (control, hook, hooking and
+// pushing other players), then every core moves. Each field is an array
+// over the characters, so the passes that treat all of them alike are
+// plain loops over floats the compiler vectorizes.
+//
+// Characters tick and move in the order they were added, the server uses
+// the order of its entity list. They enter with the tick their state is
+// from. Until the world gets there a character keeps still, the others
+// still bump into and hook it.
+//
+// With FLAG_QUANTIZE a character is rounded to the precision of the network
+// objects right after its move, as the server does with every core, so a
+// run from a snapshot reproduces the server tick for tick. FLAG_ALONE puts
+// every character into a world of its own, which is how the server advances
+// the state it sends (its dead reckoning).
+class CWorldSim
+{
+public:
+    enum
+    {
+        MAX_CHARACTERS = MAX_CLIENTS,
+    };
+
+    enum
+    {
+        FLAG_QUANTIZE = 1,
+        FLAG_ALONE = 2,
+    };
+
+    CWorldSim();
+
+    void Clear();
+    void SetFlags(int Flags) { m_Flags = Flags; }
+    void SetCharacter(int ID, const SCharacterCore& Core, int64_t Tick);
+    void GetCharacter(int ID, SCharacterCore& Core) const;
+    bool HasCharacter(int ID) const { return ID >= 0 && ID < MAX_CHARACTERS && m_aPresent[ID]; }
+
+    int64_t Tick() const { return m_Tick; }
+    // from the earliest character tick up to ToTick
+    void Run(int64_t ToTick, const CCollision& Collision, const CTuningParams& Tuning);
+    // one tick from Tick()
+    void Step(const CCollision& Collision, const CTuningParams& Tuning);
+
+private:
+    int64_t m_Tick;
+    int m_Num; // one past the highest character ID
+    int m_Flags;
+    int m_aOrder[MAX_CHARACTERS]; // IDs in the order they were added
+    int m_NumOrder;
+
+    alignas(64) float m_aPosX[MAX_CHARACTERS];
+    alignas(64) float m_aPosY[MAX_CHARACTERS];
+    alignas(64) float m_aVelX[MAX_CHARACTERS];
+    alignas(64) float m_aVelY[MAX_CHARACTERS];
+    alignas(64) float m_aHookPosX[MAX_CHARACTERS];
+    alignas(64) float m_aHookPosY[MAX_CHARACTERS];
+    alignas(64) float m_aHookDirX[MAX_CHARACTERS];
+    alignas(64) float m_aHookDirY[MAX_CHARACTERS];
+    alignas(64) float m_aRamp[MAX_CHARACTERS];
+    int m_aDirection[MAX_CHARACTERS];
+    int m_aJumped[MAX_CHARACTERS];
+    int m_aHookedPlayer[MAX_CHARACTERS];
+    int m_aHookState[MAX_CHARACTERS];
+    int m_aHookTick[MAX_CHARACTERS];
+    int64_t m_aStartTick[MAX_CHARACTERS];
+    uint8_t m_aPresent[MAX_CHARACTERS];
+    uint8_t m_aRunning[MAX_CHARACTERS]; // present and started
+    uint8_t m_aGrounded[MAX_CHARACTERS];
+
+    vec2 Pos(int i) const { return vec2(m_aPosX[i], m_aPosY[i]); }
+    vec2 Vel(int i) const { return vec2(m_aVelX[i], m_aVelY[i]); }
+    void SetVel(int i, vec2 Vel)
+    {
+        m_aVelX[i] = Vel.x;
+        m_aVelY[i] = Vel.y;
+    }
+
+    // whether character i collides with and can hook character j
+    bool Sees(int i, int j) const { return !(m_Flags & FLAG_ALONE) && j != i && HasCharacter(j); }
+
+    void TickControl(int i, const CTuningParams& Tuning);
+    void TickHook(int i, const CCollision& Collision, const CTuningParams& Tuning);
+    void TickPlayers(int i, const CTuningParams& Tuning);
+    void Move(int i, const CCollision& Collision, const CTuningParams& Tuning);
+    void Quantize(int i);
+};
+
+#endif // TEEWORLDS_WORLDSIM_H
@@ -0,0 +1,155 @@
+#include <include/base.h>
+
+#include <base/storage.h>
+#include <teeworlds/map/convert.h>
+#include <teeworlds/map/tilelayer.h>
+#include <teeworlds/six/math.h>
+#include <teeworlds/landmarks.h>
+#include <teeworlds/pathgrid.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Builds every artifact the bot keeps next to a map, the .sgc collision grid
+// and the .alt landmark tables, for all maps in tws-maps/ so a fresh bot finds
+// them ready. Run from the directory holding tws-maps.
+//
+//   sugarcane-mapc [-j threads] [-f]
+//
+// -f rebuilds artifacts that are already up to date. Landmark tables the bot
+// grew with strongholds are kept unless -f is given.
+
+struct SMapJob
+{
+    std::string m_Map;
+    std::string m_Crc;
+};
+
+static double Milliseconds(std::chrono::steady_clock::time_point Start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+// the whole report line of a map, or an empty string on failure
+static std::string CompileMap(IStorage *pStorage, const SMapJob& Job, bool Force)
+{
+    auto Start = std::chrono::steady_clock::now();
+    if(Force)
+    {
+        std::error_code Error;
+        std::filesystem::remove(std::filesystem::current_path() / "tws-maps" / Job.m_Map / (Job.m_Crc + ".sgc"), Error);
+    }
+    ESMapItems *pMap = nullptr;
+    int Width, Height;
+    bool Cached;
+    if(!LoadMapGrid(Job.m_Map.c_str(), Job.m_Crc.c_str(), &pMap, Width, Height, &Cached))
+        return std::string();
+    std::vector<char> vGridCache;
+    if(!Cached && PackMapGrid(Job.m_Map.c_str(), Job.m_Crc.c_str(), pMap, Width, Height, vGridCache))
+        pStorage->TwsWriteMapData(Job.m_Map.c_str(), Job.m_Crc.c_str(), "sgc", vGridCache.data(), vGridCache.size());
+    double GridTime = Milliseconds(Start);
+
+    // the same layer CSugarcane::LoadMap builds
+    CTileLayer Layer;
+    Layer.Init(pMap, Width, Height);
+    delete[] pMap;
+
+    Start = std::chrono::steady_clock::now();
+    CPathGrid PathGrid;
+    PathGrid.Build(Layer);
+    CLandmarks Landmarks;
+    bool Kept = false;
+    if(!Force)
+    {
+        IFileView *pTables = pStorage->TwsViewMapData(Job.m_Map.c_str(), Job.m_Crc.c_str(), "alt");
+        Kept = pTables && Landmarks.Load(pTables->Data(), PathGrid);
+        if(pTables)
+            pTables->Close();
+    }
+    if(!Kept)
+    {
+        Landmarks.Build(PathGrid);
+        std::vector<char> vData;
+        Landmarks.Save(vData);
+        if(!pStorage->TwsWriteMapData(Job.m_Map.c_str(), Job.m_Crc.c_str(), "alt", vData.data(), vData.size()))
+            return std::string();
+    }
+    double LandmarkTime = Milliseconds(Start);
+
+    return std::format("{:<24} {:>11} {:>4}x{:<4} grid {:>9} {:7.1f}ms  landmarks {:>2} {:>5} {:7.1f}ms", Job.m_Map, Job.m_Crc, Width, Height,
+        Cached ? "cached" : "converted", GridTime, Landmarks.NumLandmarks(), Kept ? "kept" : "built", LandmarkTime);
+}
+
+int main(int argc, const char **argv)
+{
+    int Threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+    bool Force = false;
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "-j") && i + 1 < argc)
+            Threads = std::max(atoi(argv[++i]), 1);
+        else if(!strcmp(argv[i], "-f"))
+            Force = true;
+        else
+        {
+            log_msg("mapc", "usage: sugarcane-mapc [-j threads] [-f]");
+            return 1;
+        }
+    }
+
+    std::filesystem::path MapsPath = std::filesystem::current_path() / "tws-maps";
+    if(!std::filesystem::is_directory(MapsPath))
+    {
+        log_msg("mapc", "no tws-maps directory here");
+        return 1;
+    }
+
+    std::vector<SMapJob> vJobs;
+    for(auto& MapDir : std::filesystem::directory_iterator(MapsPath))
+    {
+        if(!MapDir.is_directory())
+            continue;
+        for(auto& MapFile : std::filesystem::directory_iterator(MapDir.path()))
+            if(MapFile.path().extension() == ".map")
+                vJobs.push_back({MapDir.path().filename().string(), MapFile.path().stem().string()});
+    }
+
+    IStorage *pStorage = CreateStorage();
+    pStorage->Init();
+
+    auto Start = std::chrono::steady_clock::now();
+    std::atomic<size_t> NextJob(0);
+    std::atomic<int> Failed(0);
+    std::mutex LogMutex;
+    std::vector<std::thread> vWorkers;
+    for(int t = 0; t < std::min<int>(Threads, vJobs.size()); t++)
+    {
+        vWorkers.emplace_back([&]()
+        {
+            for(size_t i = NextJob++; i < vJobs.size(); i = NextJob++)
+            {
+                std::string Line = CompileMap(pStorage, vJobs[i], Force);
+                std::lock_guard<std::mutex> Lock(LogMutex);
+                if(Line.empty())
+                {
+                    Failed++;
+                    log_msgf("mapc", "{}/{} failed", vJobs[i].m_Map, vJobs[i].m_Crc);
+                }
+                else
+                    log_msg("mapc", Line);
+            }
+        });
+    }
+    for(auto& Worker : vWorkers)
+        Worker.join();
+
+    log_msgf("mapc", "{} maps on {} threads in {:.1f}ms, {} failed", vJobs.size(), std::min<int>(Threads, vJobs.size()), Milliseconds(Start), Failed.load());
+    // saves the map store index
+    delete pStorage;
+    return Failed ? 1 : 0;
+}
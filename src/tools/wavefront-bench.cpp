@@ -0,0 +1,113 @@
+#include <include/base.h>
+
+#include <teeworlds/map/convert.h>
+#include <teeworlds/six/math.h>
+#include <teeworlds/astar.h>
+
+#include <chrono>
+#include <filesystem>
+#include <random>
+
+// Times the distance field backends on every map in tws-maps/ and checks
+// that they agree tile for tile. Run from the directory holding tws-maps.
+int main(int argc, const char **argv)
+{
+    int Goals = argc > 1 ? std::max(atoi(argv[1]), 1) : 50;
+
+    std::vector<int> vBackends;
+    for(int Backend = 0; Backend < CBitWavefront::NUM_BACKENDS; Backend++)
+        if(CBitWavefront::Supported(Backend))
+            vBackends.push_back(Backend);
+
+    std::vector<double> vTotal(CBitWavefront::NUM_BACKENDS);
+    int Maps = 0;
+    int Mismatches = 0;
+    std::mt19937 Random(1);
+
+    std::filesystem::path MapsPath = std::filesystem::current_path() / "tws-maps";
+    if(!std::filesystem::is_directory(MapsPath))
+    {
+        log_msg("bench", "no tws-maps directory here");
+        return 1;
+    }
+
+    for(auto& MapDir : std::filesystem::directory_iterator(MapsPath))
+    {
+        if(!MapDir.is_directory())
+            continue;
+        for(auto& MapFile : std::filesystem::directory_iterator(MapDir.path()))
+        {
+            if(MapFile.path().extension() != ".map")
+                continue;
+
+            ESMapItems *pMap = nullptr;
+            int Width, Height;
+            if(!ConvertMap(MapDir.path().filename().c_str(), MapFile.path().stem().c_str(), &pMap, Width, Height))
+                continue;
+
+            std::vector<std::vector<int>> Grid(Height, std::vector<int>(Width));
+            std::vector<std::pair<int, int>> vOpen;
+            for(int y = 0; y < Height; y++)
+            {
+                for(int x = 0; x < Width; x++)
+                {
+                    Grid[y][x] = 0;
+                    if(pMap[y * Width + x] & ESMapItems::TILEFLAG_SOLID)
+                        Grid[y][x] = 1;
+                    if(pMap[y * Width + x] & ESMapItems::TILEFLAG_DEATH)
+                        Grid[y][x] = -1;
+                    if(!Grid[y][x])
+                        vOpen.push_back({y, x});
+                }
+            }
+            delete[] pMap;
+            if(vOpen.empty())
+                continue;
+
+            std::vector<std::pair<int, int>> vGoals;
+            for(int i = 0; i < Goals; i++)
+                vGoals.push_back(vOpen[Random() % vOpen.size()]);
+
+            std::vector<AStar> vFields(vBackends.size());
+            std::string Line = std::format("{:<24} {:>4}x{:<4}", MapDir.path().filename().string(), Width, Height);
+            for(size_t i = 0; i < vBackends.size(); i++)
+            {
+                vFields[i].setBackend(vBackends[i]);
+                auto Start = std::chrono::steady_clock::now();
+                for(auto& Goal : vGoals)
+                    vFields[i].build(Grid, Goal);
+                double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+                vTotal[vBackends[i]] += Seconds;
+                Line += std::format(" {:>6} {:8.1f}us", CBitWavefront::BackendName(vBackends[i]), Seconds * 1e6 / Goals);
+            }
+
+            // the last goal is still in every field
+            for(size_t i = 1; i < vFields.size(); i++)
+            {
+                for(int y = 0; y < Height; y++)
+                {
+                    for(int x = 0; x < Width; x++)
+                    {
+                        if(vFields[i].distanceToGoal(y, x) != vFields[0].distanceToGoal(y, x))
+                        {
+                            Mismatches++;
+                            y = Height;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            log_msg("bench", Line);
+            Maps++;
+        }
+    }
+
+    std::string Summary = std::format("{} maps, {} goals each, bit backend of this CPU {}:", Maps, Goals, CBitWavefront::BackendName(CBitWavefront::BitBackend()));
+    for(int Backend : vBackends)
+        Summary += std::format(" {} {:.3f}s ({:.2f}x)", CBitWavefront::BackendName(Backend), vTotal[Backend], vTotal[Backend] > 0 ? vTotal[CBitWavefront::BACKEND_QUEUE] / vTotal[Backend] : 0.0);
+    log_msg("bench", Summary);
+    if(Mismatches)
+        log_msgf("bench", "{} maps where the backends disagree", Mismatches);
+    return Mismatches ? 1 : 0;
+}